@@ -0,0 +1,862 @@
+#ifndef ADS_BUFFERED_SET_H
+#define ADS_BUFFERED_SET_H
+
+#include "ADS_set.h"
+
+// write-optimized ordered set (a B-epsilon tree): every internal node carries a buffer of pending insert and
+// erase messages next to its index keys. writes only add a message to the buffer of the root. a full buffer
+// hands the messages for its busiest child down as one batch, into the buffer of that child or into the leaf,
+// which is then touched once for the whole batch instead of once per key. random inserts cost a fraction of a
+// cold leaf each, lookups pay for it with a search in every buffer on their way down. the highest message for
+// a key is the newest one and wins, iteration merges the pending messages into every leaf it visits.
+// writes are blind, they do not report whether the key was there (that would take the descent they save).
+// for the same reason size() is not O(1) while messages are pending: every one of them is checked against the
+// subtree below it, flush() makes it O(1) again. empty() is O(1) unless pending erases could empty the set.
+// N and Compare are those of ADS_set: Compare has to be stateless, a transparent one enables the heterogeneous
+// lookups
+template<typename Key, size_t N = 0, typename Allocator = std::allocator<Key>, typename Compare = std::less<Key>>
+class ADS_buffered_set {
+public:
+    class Iterator;
+
+    using value_type = Key;
+    using key_type = Key;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+
+    // same node sizes as ADS_set, N == 0 derives them from ADS_node_size<Key>. the buffer of an internal node takes
+    // another leaf worth of bytes, but at most a leaf of messages, so that a leaf and a batch for it always fit
+    // into two leaves
+    static constexpr size_type internal_capacity{ N ? 2 * N : ads_detail::internal_capacity(sizeof(Key), ADS_node_size<Key>::internal_bytes) };
+    static constexpr size_type leaf_capacity{ N ? 2 * N : ads_detail::leaf_capacity(sizeof(Key), ADS_node_size<Key>::leaf_bytes) };
+    static constexpr size_type buffer_capacity{ std::clamp<size_type>(ADS_node_size<Key>::leaf_bytes / (sizeof(Key) + 1), 2, leaf_capacity) };
+
+private:
+    // internal nodes are those of ads_detail with a message buffer added, leaves are the set's own
+    using NodeType = ads_detail::NodeType;
+    using Node = ads_detail::TreeNode;
+    using IndexNode = ads_detail::IndexNode<key_type, internal_capacity>;
+    struct InternalNode;
+    struct ExternalNode;
+    using Nodes = ads_detail::NodePools<InternalNode, ExternalNode, Allocator>;
+    using link = Node*;
+
+    struct PathEntry {
+        InternalNode* node;
+        size_type childpos;
+    };
+    // internal nodes may stay below their minimum size (see rebalance_internal), but a level is only ever added
+    // by a root split, which needs a full root, and every full node took about M / 2 splits below it to fill.
+    // the height stays logarithmic in the number of inserts and far below the bit width of size_type
+    static constexpr size_type max_height{ std::numeric_limits<size_type>::digits };
+
+    static_assert(std::is_empty_v<key_compare> && std::is_default_constructible_v<key_compare>, "ADS_buffered_set needs a stateless comparator");
+    static constexpr key_compare cmp{};
+
+    // see ADS_map::arithmetic_search and ADS_set::lookup_key
+    static constexpr bool arithmetic_search{ std::is_arithmetic_v<key_type> && (std::is_same_v<key_compare, std::less<key_type>> || std::is_same_v<key_compare, std::less<>>) };
+
+    template<typename K, typename C = key_compare>
+    using lookup_key = std::enable_if_t<std::is_same_v<K, key_type> || ads_detail::is_transparent<C>::value, int>;
+
+    Nodes nodes;
+    link root;
+    size_type sz{ 0 }; // keys in the leaves, see size
+    size_type pending{ 0 }; // messages in the buffers
+    std::vector<key_type> scratch; // leaf and batch merged by apply, kept to save the allocation
+
+    // number of keys in the sorted range [keys, keys + size) less than key, or not greater than key if upper
+    template<bool upper, typename K>
+    static size_type rank(const key_type* keys, size_type size, const K& key) {
+        if constexpr(arithmetic_search && std::is_same_v<K, key_type>) {
+            return ads_detail::sorted_rank<upper>(keys, size, key);
+        } else if constexpr(upper) {
+            return static_cast<size_type>(std::upper_bound(keys, keys + size, key, cmp) - keys);
+        } else {
+            return static_cast<size_type>(std::lower_bound(keys, keys + size, key, cmp) - keys);
+        }
+    }
+
+    // the sorted keys [keys, keys + size) with the batch of count messages (ascending, newer than the keys) applied
+    static void merge_batch(const key_type* keys, size_type size, const key_type* messages, const bool* erases, size_type count,
+                            std::vector<key_type>& out) {
+        out.clear();
+        out.reserve(size + count);
+        size_type i{ 0 };
+        for (size_type j{ 0 }; j < count; ++j) {
+            for (; i < size && cmp(keys[i], messages[j]); ++i) {
+                out.push_back(keys[i]);
+            }
+            if (i < size && !cmp(messages[j], keys[i])) ++i; // the message replaces the key
+            if (!erases[j]) out.push_back(messages[j]);
+        }
+        out.insert(out.end(), keys + i, keys + size);
+    }
+
+    // drops the whole tree, the pools are released as a whole
+    void release_all() {
+        nodes.release(root);
+        root = nullptr;
+        sz = 0;
+        pending = 0;
+    }
+
+    // builds a tree without pending messages from sorted, unique keys, leaves and index nodes packed full
+    link build_tree(const std::vector<key_type>& keys) {
+        if (keys.empty()) return nodes.new_leaf();
+        size_type leaves{ (keys.size() + ExternalNode::M - 1) / ExternalNode::M };
+        std::vector<link> level;
+        std::vector<const key_type*> mins; // smallest key below each node of level
+        level.reserve(leaves);
+        mins.reserve(leaves);
+        ExternalNode* prev{ nullptr };
+        for (size_type i{ 0 }, done{ 0 }; i < leaves; ++i) {
+            ExternalNode* leaf{ nodes.new_leaf() };
+            leaf->size = keys.size() / leaves + (i < keys.size() % leaves ? 1 : 0);
+            std::copy(keys.begin() + done, keys.begin() + done + leaf->size, leaf->values);
+            if (prev) prev->next = leaf;
+            prev = leaf;
+            level.push_back(leaf);
+            mins.push_back(&keys[done]);
+            done += leaf->size;
+        }
+        return ads_detail::build_index(level, mins, [this] { return nodes.new_internal(); });
+    }
+
+    // whether key is in the subtree of node, pending messages included
+    template<typename K>
+    static bool contains(link node, const K& key) {
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type pos{ rank<false>(internal->messages, internal->buffered, key) };
+            if (pos < internal->buffered && !cmp(key, internal->messages[pos])) return !internal->erases[pos];
+            node = internal->children[internal->find_child_pos(key)];
+        }
+        ExternalNode* leaf{ static_cast<ExternalNode*>(node) };
+        size_type pos{ rank<false>(leaf->values, leaf->size, key) };
+        return pos < leaf->size && !cmp(key, leaf->values[pos]);
+    }
+
+    // where the newest copy of key lies: the insert message nearest to the root, or the key in leaf, the leaf key
+    // leads to. nullptr if key is missing, right away if a message erases it
+    template<typename K>
+    const key_type* locate(const K& key, ExternalNode*& leaf) const {
+        const key_type* found{ nullptr };
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            if (!found) {
+                size_type pos{ rank<false>(internal->messages, internal->buffered, key) };
+                if (pos < internal->buffered && !cmp(key, internal->messages[pos])) {
+                    if (internal->erases[pos]) return nullptr;
+                    found = internal->messages + pos;
+                }
+            }
+            node = internal->children[internal->find_child_pos(key)];
+        }
+        leaf = static_cast<ExternalNode*>(node);
+        if (found) return found;
+        size_type pos{ rank<false>(leaf->values, leaf->size, key) };
+        return pos < leaf->size && !cmp(key, leaf->values[pos]) ? leaf->values + pos : nullptr;
+    }
+
+    // change of the number of keys the messages below node (inclusive) make once they arrive at the leaves
+    static difference_type pending_change(link node) {
+        if (node->type == NodeType::EXTERNAL) return 0;
+        InternalNode* internal{ static_cast<InternalNode*>(node) };
+        difference_type change{ 0 };
+        for (size_type i{ 0 }; i < internal->buffered; ++i) {
+            bool below{ contains(internal->children[internal->find_child_pos(internal->messages[i])], internal->messages[i]) };
+            if (internal->erases[i] == below) change += below ? -1 : 1;
+        }
+        for (size_type i{ 0 }; i <= internal->size; ++i) {
+            change += pending_change(internal->children[i]);
+        }
+        return change;
+    }
+
+    // links right, split off the node path[depth - 1] leads to, into the parent with separator as its index
+    // key, and splits upwards as long as the nodes on the path overflow. splits hand the messages right of the
+    // separator over along with the children
+    void insert_child(PathEntry* path, size_type depth, key_type separator, link right) {
+        while (depth > 0) {
+            PathEntry& parent{ path[--depth] };
+            parent.node->insert_at(std::move(separator), parent.childpos);
+            parent.node->children[parent.childpos + 1] = right;
+            if (parent.node->size <= InternalNode::M) return;
+            InternalNode* sibling{ nodes.new_internal() };
+            separator = parent.node->split((parent.node->size - 1) / 2, sibling);
+            right = sibling;
+        }
+        TRACE_DEB("Flush triggered root split")
+        InternalNode* new_root{ nodes.new_internal() };
+        new_root->size = 1;
+        new_root->keys[0] = std::move(separator);
+        new_root->children[0] = root;
+        new_root->children[1] = right;
+        root = new_root;
+    }
+
+    // applies a batch of count messages (ascending, newer than the leaf) to leaf, which path[depth - 1] leads
+    // to, and restores the node sizes on the path. a leaf overflowing with the batch is split in two halves
+    void apply(PathEntry* path, size_type depth, ExternalNode* leaf, const key_type* messages, const bool* erases, size_type count) {
+        merge_batch(leaf->values, leaf->size, messages, erases, count, scratch);
+        sz = sz - leaf->size + scratch.size();
+        if (scratch.size() > ExternalNode::M) {
+            size_type half{ scratch.size() / 2 };
+            ExternalNode* right{ nodes.new_leaf(leaf->next) };
+            std::move(scratch.begin(), scratch.begin() + half, leaf->values);
+            std::move(scratch.begin() + half, scratch.end(), right->values);
+            leaf->size = half;
+            right->size = scratch.size() - half;
+            leaf->next = right;
+            insert_child(path, depth, right->values[0], right);
+            return;
+        }
+        std::move(scratch.begin(), scratch.end(), leaf->values);
+        leaf->size = scratch.size();
+
+        // merge upwards as long as the nodes on the path are underfull. the messages above the leaves are sorted
+        // by key, not by child, so the buffers stay as they are when keys move between leaves
+        if (depth > 0 && leaf->size < ExternalNode::min_size && path[depth - 1].node->size > 0) {
+            if (link emptied{ ads_detail::rebalance<ExternalNode>(path[depth - 1].node, path[depth - 1].childpos) }) nodes.free_node(emptied);
+            for (--depth; depth > 0 && path[depth].node->size < InternalNode::min_size && path[depth - 1].node->size > 0; --depth) {
+                rebalance_internal(path, depth - 1);
+            }
+        }
+    }
+
+    // like ADS_set::rebalance for the underfull internal node path[level] leads to, as long as the messages
+    // moving along with the children fit into the buffer they move to. the node stays underfull otherwise,
+    // which costs space, but no correctness: all leaves remain on the same level
+    void rebalance_internal(PathEntry* path, size_type level) {
+        InternalNode* parent{ path[level].node };
+        size_type leftpos{ path[level].childpos > 0 ? path[level].childpos - 1 : 0 };
+        InternalNode* left{ static_cast<InternalNode*>(parent->children[leftpos]) };
+        InternalNode* right{ static_cast<InternalNode*>(parent->children[leftpos + 1]) };
+        key_type& separator{ parent->keys[leftpos] };
+        if (left->size + right->size < 2 * InternalNode::min_size) {
+            if (left->buffered + right->buffered > InternalNode::B) return;
+            left->merge(separator, right);
+            nodes.free_node(right);
+            parent->erase_at(leftpos);
+        } else if (left->size > right->size + 1) {
+            size_type count{ (left->size - right->size) / 2 };
+            size_type moved{ left->buffered - rank<false>(left->messages, left->buffered, left->keys[left->size - count]) };
+            if (right->buffered + moved > InternalNode::B) return;
+            right->borrow_left(separator, left, count);
+        } else if (right->size > left->size + 1) {
+            size_type count{ (right->size - left->size) / 2 };
+            size_type moved{ rank<false>(right->messages, right->buffered, right->keys[count - 1]) };
+            if (left->buffered + moved > InternalNode::B) return;
+            left->borrow_right(separator, right, count);
+        }
+    }
+
+    // moves one batch of messages one level down: the messages of the root for its busiest child go into that
+    // child. if the child has no room for them, the child's busiest batch goes further down first, and so on,
+    // until a batch fits into a buffer or reaches a leaf. every call makes progress, none moves a message up
+    void push_down() {
+        PathEntry path[max_height];
+        size_type depth{ 0 };
+        InternalNode* node{ static_cast<InternalNode*>(root) };
+        while (true) {
+            size_type childpos{ node->busiest_child() };
+            size_type first{ node->batch_begin(childpos) };
+            size_type last{ node->batch_end(childpos) };
+            path[depth++] = PathEntry{ node, childpos };
+            link child{ node->children[childpos] };
+            if (child->type == NodeType::EXTERNAL) {
+                // the batch leaves the buffer before the leaf is written, splits below may split node as well
+                key_type messages[InternalNode::B];
+                bool erases[InternalNode::B];
+                std::move(node->messages + first, node->messages + last, messages);
+                std::copy(node->erases + first, node->erases + last, erases);
+                node->erase_messages(first, last);
+                pending -= last - first;
+                apply(path, depth, static_cast<ExternalNode*>(child), messages, erases, last - first);
+                return;
+            }
+            InternalNode* internal{ static_cast<InternalNode*>(child) };
+            if (internal->buffered + (last - first) <= InternalNode::B) {
+                pending -= internal->absorb(node->messages + first, node->erases + first, last - first);
+                node->erase_messages(first, last);
+                return;
+            }
+            node = internal;
+        }
+    }
+
+    // a root with a single child (left behind by merges below it) is replaced by the child once its messages
+    // are down there
+    void collapse_root() {
+        while (root->type == NodeType::INTERNAL && root->size == 0) {
+            InternalNode* top{ static_cast<InternalNode*>(root) };
+            link child{ top->children[0] };
+            if (top->buffered > 0) {
+                if (child->type == NodeType::EXTERNAL || static_cast<InternalNode*>(child)->buffered + top->buffered > InternalNode::B) {
+                    push_down();
+                    continue;
+                }
+                pending -= static_cast<InternalNode*>(child)->absorb(top->messages, top->erases, top->buffered);
+            }
+            TRACE_DEB("Collapsing root")
+            root = child;
+            nodes.free_node(top);
+        }
+    }
+
+    // adds the message for key to the root, a root leaf takes it right away
+    void write(const key_type& key, bool erase) {
+        if (root == Nodes::empty_root()) root = nodes.new_leaf();
+        if (root->type == NodeType::EXTERNAL) {
+            apply(nullptr, 0, static_cast<ExternalNode*>(root), &key, &erase, 1);
+            return;
+        }
+        while (static_cast<InternalNode*>(root)->buffered == InternalNode::B && !static_cast<InternalNode*>(root)->holds(key)) {
+            push_down();
+        }
+        if (static_cast<InternalNode*>(root)->add(key, erase)) ++pending;
+        collapse_root();
+    }
+
+    // the keys of the leaf key leads to (the first leaf for nullptr) with the pending messages for them applied.
+    // the leaf covers the keys from the nearest separator left of the path up to the nearest one right of it,
+    // exactly these messages of every buffer on the path belong to it. they are applied oldest (lowest) first
+    template<typename K>
+    void load(Iterator& it, const K* key) const {
+        InternalNode* path[max_height];
+        size_type depth{ 0 };
+        const key_type* lo{ nullptr };
+        const key_type* hi{ nullptr };
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ key ? internal->find_child_pos(*key) : 0 };
+            if (childpos > 0) lo = internal->keys + childpos - 1;
+            if (childpos < internal->size) hi = internal->keys + childpos;
+            path[depth++] = internal;
+            node = internal->children[childpos];
+        }
+        ExternalNode* leaf{ static_cast<ExternalNode*>(node) };
+        it.leaf = leaf;
+        it.fence = hi;
+        it.keys = leaf->values;
+        it.count = leaf->size;
+        it.pos = 0;
+        it.located = false;
+        it.merged.reset();
+        while (depth-- > 0) {
+            InternalNode* internal{ path[depth] };
+            size_type first{ lo ? rank<false>(internal->messages, internal->buffered, *lo) : 0 };
+            size_type last{ hi ? rank<false>(internal->messages, internal->buffered, *hi) : internal->buffered };
+            if (first == last) continue;
+            std::shared_ptr<std::vector<key_type>> merged{ std::make_shared<std::vector<key_type>>() };
+            merge_batch(it.keys, it.count, internal->messages + first, internal->erases + first, last - first, *merged);
+            it.merged = std::move(merged);
+            it.keys = it.merged->data();
+            it.count = it.merged->size();
+        }
+    }
+
+    // moves it on to the next leaf as long as it is past the keys of its own, end() after the last one
+    void skip_exhausted(Iterator& it) const {
+        while (it.pos == it.count) {
+            if (!it.fence) {
+                it = Iterator();
+                return;
+            }
+            load(it, it.fence);
+        }
+    }
+
+    // moves an iterator from find past its key, in the leaf merged with its messages only now
+    void step_located(Iterator& it) const {
+        const key_type* key{ it.keys };
+        load(it, key);
+        it.pos = rank<true>(it.keys, it.count, *key);
+    }
+
+    template<bool upper, typename K>
+    iterator bound(const K& key) const {
+        Iterator it{ this };
+        load(it, &key);
+        it.pos = rank<upper>(it.keys, it.count, key);
+        skip_exhausted(it);
+        return it;
+    }
+
+public:
+    ADS_buffered_set() : ADS_buffered_set(Allocator()) {}
+
+    explicit ADS_buffered_set(const Allocator& alloc) : nodes{ alloc }, root{ nullptr } {
+        root = nodes.new_leaf();
+    }
+
+    ADS_buffered_set(std::initializer_list<key_type> ilist, const Allocator& alloc = Allocator())
+            : ADS_buffered_set(ilist.begin(), ilist.end(), alloc) {}
+
+    template<typename InputIt>
+    ADS_buffered_set(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+            : nodes{ alloc }, root{ nullptr } {
+        std::vector<key_type> keys(first, last);
+        std::sort(keys.begin(), keys.end(), cmp);
+        keys.erase(std::unique(keys.begin(), keys.end(), [](const key_type& lhs, const key_type& rhs) { return !cmp(lhs, rhs); }), keys.end());
+        root = build_tree(keys);
+        sz = keys.size();
+    }
+
+    // the copy has all pending messages applied
+    ADS_buffered_set(const ADS_buffered_set& other)
+            : nodes{ std::allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator()) },
+              root{ nullptr } {
+        std::vector<key_type> keys(other.begin(), other.end());
+        root = build_tree(keys);
+        sz = keys.size();
+    }
+
+    ADS_buffered_set(ADS_buffered_set&& other) noexcept
+            : nodes{ std::move(other.nodes) },
+              root{ other.root },
+              sz{ other.sz },
+              pending{ other.pending } {
+        other.root = Nodes::empty_root();
+        other.sz = 0;
+        other.pending = 0;
+    }
+
+    ~ADS_buffered_set() {
+        release_all();
+    }
+
+    ADS_buffered_set& operator=(const ADS_buffered_set& other) {
+        if (this != &other) {
+            ADS_buffered_set copy{ other };
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ADS_buffered_set& operator=(ADS_buffered_set&& other) noexcept {
+        if (this != &other) {
+            ADS_buffered_set moved{ std::move(other) };
+            swap(moved);
+        }
+        return *this;
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const {
+        return nodes.get_allocator();
+    }
+
+    // O(1) without pending messages, otherwise every message is checked against the subtree below its buffer
+    // for whether it will change the number of keys once it arrives. flush first to pay this only once
+    [[nodiscard]] size_type size() const {
+        if (pending == 0) return sz;
+        return static_cast<size_type>(static_cast<difference_type>(sz) + pending_change(root));
+    }
+
+    // every message erases at most one key and nothing overrides the messages of the root, so more keys in the
+    // leaves than messages or an insert in the root buffer settle it. otherwise the first key is looked for,
+    // which stops at the first leaf that keeps one
+    [[nodiscard]] bool empty() const {
+        if (sz > pending) return false;
+        if (root->type == NodeType::INTERNAL) {
+            const InternalNode* top{ static_cast<const InternalNode*>(root) };
+            if (std::find(top->erases, top->erases + top->buffered, false) != top->erases + top->buffered) return false;
+        }
+        return begin() == end();
+    }
+
+    // number of messages in the buffers that have not reached their leaves yet
+    [[nodiscard]] size_type pending_messages() const {
+        return pending;
+    }
+
+    void insert(const key_type& key) {
+        TRACE_INF("Inserting element: " << key)
+        write(key, false);
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            write(*first, false);
+        }
+    }
+
+    void insert(std::initializer_list<key_type> ilist) {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    void erase(const key_type& key) {
+        TRACE_INF("Erasing element: " << key)
+        write(key, true);
+    }
+
+    // applies all pending messages by rebuilding the tree from its keys, the leaves are packed full. O(n)
+    void flush() {
+        if (pending == 0) return;
+        std::vector<key_type> keys(begin(), end());
+        release_all();
+        root = build_tree(keys);
+        sz = keys.size();
+    }
+
+    void clear() {
+        release_all();
+        root = nodes.new_leaf();
+    }
+
+    size_type count(const key_type& key) const {
+        return count<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    size_type count(const K& key) const {
+        return contains(root, key) ? 1 : 0;
+    }
+
+    iterator find(const key_type& key) const {
+        return find<key_type>(key);
+    }
+
+    // a hit points to the stored copy of key, the leaf around it is merged with its messages only once the
+    // iterator is advanced. a miss costs no more than count
+    template<typename K, lookup_key<K> = 0>
+    iterator find(const K& key) const {
+        Iterator it{ this };
+        it.keys = locate(key, it.leaf);
+        if (!it.keys) return end();
+        it.count = 1;
+        it.located = true;
+        return it;
+    }
+
+    // first key not less than key
+    iterator lower_bound(const key_type& key) const {
+        return lower_bound<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    iterator lower_bound(const K& key) const {
+        return bound<false>(key);
+    }
+
+    // first key greater than key
+    iterator upper_bound(const key_type& key) const {
+        return upper_bound<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    iterator upper_bound(const K& key) const {
+        return bound<true>(key);
+    }
+
+    // calls visitor with every key in [lo, hi) in ascending order and returns the number of visited keys, like
+    // ADS_set::for_each_in_range
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) const {
+        size_type visited{ 0 };
+        for (iterator it{ lower_bound(lo) }; it != end() && cmp(*it, hi); ++it) {
+            ++visited;
+            if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                if (!visitor(*it)) break;
+            } else {
+                visitor(*it);
+            }
+        }
+        return visited;
+    }
+
+    const_iterator begin() const {
+        Iterator it{ this };
+        load<key_type>(it, nullptr);
+        skip_exhausted(it);
+        return it;
+    }
+
+    const_iterator end() const {
+        return Iterator();
+    }
+
+    void swap(ADS_buffered_set& other) {
+        nodes.swap(other.nodes);
+        std::swap(root, other.root);
+        std::swap(sz, other.sz);
+        std::swap(pending, other.pending);
+    }
+
+    bool operator==(const ADS_buffered_set& rhs) const {
+        const_iterator itr{ rhs.begin() };
+        for (const_iterator itl{ begin() }; itl != end(); ++itl, ++itr) {
+            if (itr == rhs.end() || cmp(*itl, *itr) || cmp(*itr, *itl)) return false;
+        }
+        return itr == rhs.end();
+    }
+
+    bool operator!=(const ADS_buffered_set& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+// walks the leaves like the iterator of ADS_set, but through the keys of a leaf with its pending messages
+// applied. a leaf without messages for it is read in place, any other is merged into a vector shared by the
+// copies of the iterator. the next leaf is found by a descent to the fence of the current one. iterators from
+// find see nothing but their key until they are advanced. iterators on the same leaf may hold different copies
+// of its keys, so they are compared by key unless they share them. references stay valid only as long as an
+// iterator on the same leaf exists (see the note on the iterator of ADS_set)
+template<typename Key, size_t N, typename Allocator, typename Compare>
+class ADS_buffered_set<Key, N, Allocator, Compare>::Iterator {
+    friend class ADS_buffered_set;
+
+public:
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using iterator_category = std::input_iterator_tag;
+
+private:
+    const ADS_buffered_set* set{ nullptr };
+    ExternalNode* leaf{ nullptr }; // nullptr for end()
+    std::shared_ptr<const std::vector<key_type>> merged; // the keys, unless they are read from leaf in place
+    const key_type* keys{ nullptr };
+    size_type count{ 0 };
+    size_type pos{ 0 };
+    const key_type* fence{ nullptr }; // first key right of the leaf, nullptr for the last leaf
+    bool located{ false }; // from find: keys is the found key where it is stored, the leaf is not loaded yet
+
+    explicit Iterator(const ADS_buffered_set* _set) : set{ _set } {}
+
+public:
+    Iterator() = default;
+
+    reference operator*() const {
+        return keys[pos];
+    }
+
+    pointer operator->() const {
+        return keys + pos;
+    }
+
+    Iterator& operator++() {
+        if (leaf) {
+            if (located) {
+                set->step_located(*this);
+            } else {
+                ++pos;
+            }
+            set->skip_exhausted(*this);
+        }
+        return *this;
+    }
+
+    Iterator operator++(int) {
+        Iterator old{ *this };
+        this->operator++();
+        return old;
+    }
+
+    bool operator==(const Iterator& rhs) const {
+        if (leaf != rhs.leaf) return false;
+        if (keys == rhs.keys) return pos == rhs.pos;
+        return !cmp(keys[pos], rhs.keys[rhs.pos]) && !cmp(rhs.keys[rhs.pos], keys[pos]);
+    }
+
+    bool operator!=(const Iterator& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+// the index node of ads_detail plus the buffer: B messages sorted by key, at most one per key. every message
+// lies in the key range of the node and belongs to the child that key leads to. the structural operations of
+// the index node move the messages along with the children
+template<typename Key, size_t N, typename Allocator, typename Compare>
+struct ADS_buffered_set<Key, N, Allocator, Compare>::InternalNode : public IndexNode {
+    static constexpr size_type B{ buffer_capacity };
+    size_type buffered{ 0 };
+    key_type messages[B];
+    bool erases[B]; // whether messages[i] erases its key, it inserts it otherwise
+
+    InternalNode() : IndexNode() {}
+
+    template<typename K>
+    size_type find_child_pos(const K& key) const {
+        return rank<true>(this->keys, this->size, key); // keys equal to a separator live right of it
+    }
+
+    // the messages for child childpos are [batch_begin(childpos), batch_end(childpos))
+    size_type batch_begin(size_type childpos) const {
+        return childpos > 0 ? rank<false>(messages, buffered, this->keys[childpos - 1]) : 0;
+    }
+
+    size_type batch_end(size_type childpos) const {
+        return childpos < this->size ? rank<false>(messages, buffered, this->keys[childpos]) : buffered;
+    }
+
+    // the child most messages are for, in one pass over separators and messages
+    size_type busiest_child() const {
+        size_type best{ 0 };
+        size_type best_count{ 0 };
+        size_type first{ 0 };
+        for (size_type childpos{ 0 }; childpos <= this->size && first < buffered; ++childpos) {
+            size_type last{ first };
+            if (childpos < this->size) {
+                while (last < buffered && cmp(messages[last], this->keys[childpos])) ++last;
+            } else {
+                last = buffered;
+            }
+            if (last - first > best_count) {
+                best = childpos;
+                best_count = last - first;
+            }
+            first = last;
+        }
+        return best;
+    }
+
+    bool holds(const key_type& key) const {
+        size_type pos{ rank<false>(messages, buffered, key) };
+        return pos < buffered && !cmp(key, messages[pos]);
+    }
+
+    // adds the message for key, which replaces an older one for the same key. returns whether the buffer grew,
+    // it needs room for that
+    bool add(const key_type& key, bool erase) {
+        size_type pos{ rank<false>(messages, buffered, key) };
+        if (pos < buffered && !cmp(key, messages[pos])) {
+            erases[pos] = erase;
+            return false;
+        }
+        std::move_backward(messages + pos, messages + buffered, messages + buffered + 1);
+        std::copy_backward(erases + pos, erases + buffered, erases + buffered + 1);
+        messages[pos] = key;
+        erases[pos] = erase;
+        ++buffered;
+        return true;
+    }
+
+    // merges the batch of count messages (ascending, newer than the buffer) into the buffer, which needs room for
+    // all of them. merged from the back, a message replacing an older one leaves a gap that is closed at the end.
+    // returns the number of replaced messages
+    size_type absorb(key_type* batch, const bool* batch_erases, size_type count) {
+        size_type i{ buffered };
+        size_type pos{ buffered + count };
+        for (size_type j{ count }; j > 0;) {
+            if (i > 0 && cmp(batch[j - 1], messages[i - 1])) {
+                --pos;
+                messages[pos] = std::move(messages[--i]);
+                erases[pos] = erases[i];
+            } else {
+                if (i > 0 && !cmp(messages[i - 1], batch[j - 1])) --i; // replaced
+                --pos;
+                messages[pos] = std::move(batch[--j]);
+                erases[pos] = batch_erases[j];
+            }
+        }
+        size_type replaced{ pos - i };
+        if (replaced > 0) {
+            std::move(messages + pos, messages + buffered + count, messages + i);
+            std::copy(erases + pos, erases + buffered + count, erases + i);
+        }
+        buffered += count - replaced;
+        return replaced;
+    }
+
+    void erase_messages(size_type first, size_type last) {
+        std::move(messages + last, messages + buffered, messages + first);
+        std::copy(erases + last, erases + buffered, erases + first);
+        buffered -= last - first;
+    }
+
+    // moves everything after split_at to the empty node right, the messages from the returned index key on as well
+    key_type split(size_type split_at, InternalNode* right) {
+        size_type first{ rank<false>(messages, buffered, this->keys[split_at]) };
+        std::move(messages + first, messages + buffered, right->messages);
+        std::copy(erases + first, erases + buffered, right->erases);
+        right->buffered = buffered - first;
+        buffered = first;
+        return IndexNode::split(split_at, right);
+    }
+
+    // see IndexNode::borrow_left, the messages for the children that move come along
+    void borrow_left(key_type& separator, InternalNode* left, size_type count) {
+        size_type first{ rank<false>(left->messages, left->buffered, left->keys[left->size - count]) };
+        size_type moved{ left->buffered - first };
+        std::move_backward(messages, messages + buffered, messages + buffered + moved);
+        std::copy_backward(erases, erases + buffered, erases + buffered + moved);
+        std::move(left->messages + first, left->messages + left->buffered, messages);
+        std::copy(left->erases + first, left->erases + left->buffered, erases);
+        buffered += moved;
+        left->buffered = first;
+        IndexNode::borrow_left(separator, left, count);
+    }
+
+    // see IndexNode::borrow_right, the messages for the children that move come along
+    void borrow_right(key_type& separator, InternalNode* right, size_type count) {
+        size_type moved{ rank<false>(right->messages, right->buffered, right->keys[count - 1]) };
+        std::move(right->messages, right->messages + moved, messages + buffered);
+        std::copy(right->erases, right->erases + moved, erases + buffered);
+        buffered += moved;
+        right->erase_messages(0, moved);
+        IndexNode::borrow_right(separator, right, count);
+    }
+
+    // appends the neighbour right of this node, the buffers have to fit into one
+    void merge(key_type& pulled_down, InternalNode* neighbour) {
+        IndexNode::merge(pulled_down, neighbour);
+        std::move(neighbour->messages, neighbour->messages + neighbour->buffered, messages + buffered);
+        std::copy(neighbour->erases, neighbour->erases + neighbour->buffered, erases + buffered);
+        buffered += neighbour->buffered;
+    }
+};
+
+// a plain sorted key array, with the split, borrow and merge interface ads_detail::rebalance expects
+template<typename Key, size_t N, typename Allocator, typename Compare>
+struct ADS_buffered_set<Key, N, Allocator, Compare>::ExternalNode : public Node {
+    static constexpr size_type M{ leaf_capacity };
+    static constexpr size_type min_size{ M / 2 };
+    ExternalNode* next;
+    key_type values[M];
+
+    explicit ExternalNode(ExternalNode* _next = nullptr) : Node(NodeType::EXTERNAL, 0), next{ _next } {}
+
+    // moves the last count keys of left (the left neighbour) to the front, separator becomes the new first key
+    void borrow_left(key_type& separator, ExternalNode* left, size_type count) {
+        std::move_backward(values, values + this->size, values + this->size + count);
+        std::move(left->values + left->size - count, left->values + left->size, values);
+        left->size -= count;
+        this->size += count;
+        separator = values[0];
+    }
+
+    // appends the first count keys of right (the right neighbour), separator becomes its new first key
+    void borrow_right(key_type& separator, ExternalNode* right, size_type count) {
+        std::move(right->values, right->values + count, values + this->size);
+        std::move(right->values + count, right->values + right->size, right->values);
+        right->size -= count;
+        this->size += count;
+        separator = right->values[0];
+    }
+
+    // appends all keys of neighbour, the next leaf. the index key between them is dropped by the parent
+    void merge(key_type&, ExternalNode* neighbour) {
+        std::move(neighbour->values, neighbour->values + neighbour->size, values + this->size);
+        this->size += neighbour->size;
+        next = neighbour->next;
+    }
+};
+
+template<typename Key, size_t N, typename Allocator, typename Compare>
+void swap(ADS_buffered_set<Key, N, Allocator, Compare>& lhs, ADS_buffered_set<Key, N, Allocator, Compare>& rhs) {
+    lhs.swap(rhs);
+}
+
+#endif
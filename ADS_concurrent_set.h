@@ -0,0 +1,679 @@
+#ifndef ADS_CONCURRENT_SET_H
+#define ADS_CONCURRENT_SET_H
+
+#include "ADS_set.h"
+
+#include<atomic>
+#include<mutex>
+#include<thread>
+
+namespace ads_detail {
+    // busy-wait hint between two attempts of an optimistic operation
+    inline void cpu_relax() {
+#if defined(__SSE2__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // version word for optimistic lock coupling. the lowest bit is the write lock, every unlock advances the
+    // version, so a reader that saw the same unlocked version before and after reading a node read a
+    // consistent state of it
+    class OptimisticLock {
+        static constexpr uint64_t locked_bit{ 1 };
+        std::atomic<uint64_t> word{ 0 };
+
+    public:
+        // stores the current version, false if the node is locked (the caller restarts)
+        bool read_lock(uint64_t& version) const {
+            version = word.load(std::memory_order_acquire);
+            return (version & locked_bit) == 0;
+        }
+
+        // true if the node has not been written since read_lock returned version
+        bool validate(uint64_t version) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return word.load(std::memory_order_relaxed) == version;
+        }
+
+        // takes the write lock if the node is still at version. the fence keeps the writes to the node that
+        // follow from becoming visible before the lock bit (the seqlock writer pattern), otherwise a reader on a
+        // weakly ordered CPU could see a half-written node and still validate it against the old version
+        bool upgrade(uint64_t version) {
+            if (!word.compare_exchange_strong(version, version | locked_bit, std::memory_order_acq_rel, std::memory_order_relaxed)) return false;
+            std::atomic_thread_fence(std::memory_order_release);
+            return true;
+        }
+
+        void unlock() {
+            word.fetch_add(locked_bit, std::memory_order_release);
+        }
+    };
+
+    // epoch based reclamation of nodes that optimistic readers may still hold after they were unlinked. every
+    // operation runs in the epoch it entered and is counted there, in one of a few striped counters so that
+    // threads do not share a cache line. the epoch only advances once no operation of the previous one runs
+    // anymore, so a node unlinked and retired in epoch e is unreachable for everybody once the epoch is e + 2
+    class EpochManager {
+        static constexpr size_t stripes{ 8 };
+        struct alignas(cache_line_size) Stripe {
+            std::atomic<size_t> active[3]{};
+        };
+        Stripe stripe[stripes];
+        std::atomic<uint64_t> epoch{ 0 };
+
+        static size_t this_stripe() {
+            static thread_local size_t index{ std::hash<std::thread::id>{}(std::this_thread::get_id()) % stripes };
+            return index;
+        }
+
+    public:
+        // the result goes to leave. the second look at the epoch makes sure that try_advance, which may have
+        // checked the counter in between, sees this operation or that it is not counted in a stale epoch
+        uint64_t enter() {
+            std::atomic<size_t>* active{ stripe[this_stripe()].active };
+            while (true) {
+                uint64_t current{ epoch.load() };
+                active[current % 3].fetch_add(1);
+                if (epoch.load() == current) return current;
+                active[current % 3].fetch_sub(1);
+            }
+        }
+
+        void leave(uint64_t entered) {
+            stripe[this_stripe()].active[entered % 3].fetch_sub(1, std::memory_order_release);
+        }
+
+        uint64_t current() const {
+            return epoch.load();
+        }
+
+        // moves on to the next epoch if no operation of the previous one is running anymore, the callers have
+        // to be serialized. after that, what was retired in the previous epoch can be freed
+        bool try_advance() {
+            uint64_t current{ epoch.load() };
+            for (const Stripe& s: stripe) {
+                if (s.active[(current + 2) % 3].load() != 0) return false;
+            }
+            epoch.store(current + 1);
+            return true;
+        }
+    };
+
+    // keeps the nodes an operation reads from being freed while it runs
+    class EpochGuard {
+        EpochManager& manager;
+        uint64_t entered;
+
+    public:
+        explicit EpochGuard(EpochManager& _manager) : manager{ _manager }, entered{ _manager.enter() } {}
+
+        EpochGuard(const EpochGuard&) = delete;
+
+        EpochGuard& operator=(const EpochGuard&) = delete;
+
+        ~EpochGuard() {
+            manager.leave(entered);
+        }
+    };
+}
+
+// B+ tree for concurrent use without an external mutex, synchronized by optimistic lock coupling:
+// every node carries a version word. readers descend and read nodes without writing shared memory and
+// validate the versions afterwards, restarting if a writer got in the way. writers lock only the leaf they
+// change and, for a split, the node and its parent. full nodes are split on the way down, so a split never
+// propagates further up. an erase that leaves its leaf underfull makes another pass down, which merges the
+// first underfull node on the path into a neighbour with the parent, the node and the neighbour locked, and
+// replaces a root left with a single child by that child. unlinked nodes stay locked, so that everybody
+// still holding them restarts, and are freed through epochs (see EpochManager) once no operation can
+// reach them anymore. keys are read while they may be written, so they have to be trivially copyable.
+// there are no iterators, ranges are visited through for_each_in_range, which follows the leaf chain
+template<typename Key, size_t N = 0, typename Allocator = std::allocator<Key>>
+class ADS_concurrent_set {
+public:
+    using value_type = Key;
+    using key_type = Key;
+    using size_type = size_t;
+    using key_compare = std::less<key_type>;
+    using allocator_type = Allocator;
+
+    // same defaults as ADS_set, see ADS_node_size
+    static constexpr size_type internal_capacity{ N ? 2 * N : ads_detail::internal_capacity(sizeof(Key), ADS_node_size<Key>::internal_bytes) };
+    static constexpr size_type leaf_capacity{ N ? 2 * N : ads_detail::leaf_capacity(sizeof(Key), ADS_node_size<Key>::leaf_bytes) };
+
+    static_assert(std::is_trivially_copyable_v<key_type>, "optimistic readers may see keys mid-write, keys have to be trivially copyable");
+
+private:
+    enum class NodeType : unsigned char {
+        INTERNAL,
+        EXTERNAL
+    };
+    struct Node;
+    struct InternalNode;
+    struct ExternalNode;
+
+    // outcome of a single optimistic attempt
+    enum class Attempt {
+        DONE,
+        NOTHING_TO_DO,
+        RESTART
+    };
+
+    static constexpr key_compare cmp{};
+
+    ads_detail::NodePool<InternalNode, Allocator> internal_pool;
+    ads_detail::NodePool<ExternalNode, Allocator> external_pool;
+    std::mutex pool_mutex; // splits and merges of different threads allocate and retire concurrently
+    std::vector<Node*> retired[3]; // unlinked nodes by the epoch they were retired in, guarded by pool_mutex
+    mutable ads_detail::EpochManager epochs;
+    std::atomic<Node*> root;
+    std::atomic<size_type> sz{ 0 };
+
+    InternalNode* new_internal() {
+        std::lock_guard<std::mutex> guard{ pool_mutex };
+        return new(internal_pool.allocate()) InternalNode();
+    }
+
+    ExternalNode* new_external(ExternalNode* next = nullptr) {
+        std::lock_guard<std::mutex> guard{ pool_mutex };
+        return new(external_pool.allocate()) ExternalNode(next);
+    }
+
+    // hands the unlinked (and still locked) node over to be freed two epochs later, and frees what was retired
+    // in the previous epoch if the epoch can advance. keys are trivially destructible, nodes are just deallocated
+    void retire(Node* node) {
+        std::lock_guard<std::mutex> guard{ pool_mutex };
+        uint64_t epoch{ epochs.current() };
+        retired[epoch % 3].push_back(node);
+        if (!epochs.try_advance()) return;
+        for (Node* old: retired[(epoch + 2) % 3]) {
+            if (old->type == NodeType::INTERNAL) {
+                internal_pool.deallocate(static_cast<InternalNode*>(old));
+            } else {
+                external_pool.deallocate(static_cast<ExternalNode*>(old));
+            }
+        }
+        retired[(epoch + 2) % 3].clear();
+    }
+
+    // reads the root and its version, fails if the root is locked or was replaced in between
+    Node* read_root(uint64_t& version) const {
+        Node* node{ root.load(std::memory_order_acquire) };
+        if (!node->lock.read_lock(version) || root.load(std::memory_order_acquire) != node) return nullptr;
+        return node;
+    }
+
+    // optimistic descent to the leaf responsible for key, nullptr if a concurrent write got in the way.
+    // the version of the returned leaf has to be validated after reading it
+    ExternalNode* find_leaf(const key_type& key, uint64_t& version) const {
+        Node* node{ read_root(version) };
+        if (!node) return nullptr;
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            Node* child{ internal->children[internal->find_child_pos(key)].load(std::memory_order_relaxed) };
+            uint64_t child_version;
+            if (!child || !child->lock.read_lock(child_version) || !internal->lock.validate(version)) return nullptr;
+            node = child;
+            version = child_version;
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // splits the write locked, full node. parent is write locked as well and has room for one more child
+    // (node is at childpos), or nullptr if node is the root
+    void split(Node* node, InternalNode* parent, size_type childpos) {
+        Node* right;
+        key_type separator;
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            InternalNode* right_internal{ new_internal() };
+            separator = internal->split(right_internal);
+            right = right_internal;
+        } else {
+            ExternalNode* leaf{ static_cast<ExternalNode*>(node) };
+            ExternalNode* right_leaf{ new_external(leaf->next.load(std::memory_order_relaxed)) };
+            separator = leaf->split(right_leaf);
+            right = right_leaf;
+        }
+        if (parent) {
+            parent->insert_at(separator, childpos, right);
+        } else {
+            InternalNode* new_root{ new_internal() };
+            new_root->values[0] = separator;
+            new_root->children[0].store(node, std::memory_order_relaxed);
+            new_root->children[1].store(right, std::memory_order_relaxed);
+            new_root->size.store(1, std::memory_order_relaxed);
+            root.store(new_root, std::memory_order_release);
+        }
+    }
+
+    Attempt try_insert(const key_type& key) {
+        uint64_t version;
+        Node* node{ read_root(version) };
+        if (!node) return Attempt::RESTART;
+        InternalNode* parent{ nullptr };
+        uint64_t parent_version{ 0 };
+        size_type childpos{ 0 };
+        while (true) {
+            if (node->full()) { // split eagerly, the parent was not full when it was passed
+                if (parent && !parent->lock.upgrade(parent_version)) return Attempt::RESTART;
+                if (!node->lock.upgrade(version)) {
+                    if (parent) parent->lock.unlock();
+                    return Attempt::RESTART;
+                }
+                if (!parent && root.load(std::memory_order_relaxed) != node) { // a concurrent root split won
+                    node->lock.unlock();
+                    return Attempt::RESTART;
+                }
+                split(node, parent, childpos);
+                node->lock.unlock();
+                if (parent) parent->lock.unlock();
+                return Attempt::RESTART; // descend again, now with room on the way
+            }
+            if (node->type == NodeType::EXTERNAL) break;
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type pos{ internal->find_child_pos(key) };
+            Node* child{ internal->children[pos].load(std::memory_order_relaxed) };
+            uint64_t child_version;
+            if (!child || !child->lock.read_lock(child_version) || !internal->lock.validate(version)) return Attempt::RESTART;
+            parent = internal;
+            parent_version = version;
+            childpos = pos;
+            node = child;
+            version = child_version;
+        }
+
+        ExternalNode* leaf{ static_cast<ExternalNode*>(node) };
+        size_type pos{ leaf->lower_pos(key) };
+        if (leaf->holds_at(key, pos)) return leaf->lock.validate(version) ? Attempt::NOTHING_TO_DO : Attempt::RESTART;
+        if (!leaf->lock.upgrade(version)) return Attempt::RESTART; // pos is still valid if this succeeds
+        leaf->insert_at(key, pos);
+        leaf->lock.unlock();
+        sz.fetch_add(1, std::memory_order_relaxed);
+        return Attempt::DONE;
+    }
+
+    // underfull tells whether the leaf needs a merge pass afterwards
+    Attempt try_erase(const key_type& key, bool& underfull) {
+        uint64_t version;
+        ExternalNode* leaf{ find_leaf(key, version) };
+        if (!leaf) return Attempt::RESTART;
+        size_type pos{ leaf->lower_pos(key) };
+        if (!leaf->holds_at(key, pos)) return leaf->lock.validate(version) ? Attempt::NOTHING_TO_DO : Attempt::RESTART;
+        if (!leaf->lock.upgrade(version)) return Attempt::RESTART;
+        leaf->erase_at(pos);
+        underfull = leaf->underfull();
+        leaf->lock.unlock();
+        sz.fetch_sub(1, std::memory_order_relaxed);
+        return Attempt::DONE;
+    }
+
+    // merges the underfull node at childpos of parent (both read at their versions) into a neighbour under the
+    // same parent, the one to the right first. the merge needs all three write locked and has to leave a node
+    // that is not full, otherwise the next insert would split it again right away
+    Attempt merge(InternalNode* parent, uint64_t parent_version, size_type childpos, Node* node, uint64_t version) {
+        size_type parent_size{ std::min(parent->size.load(std::memory_order_relaxed), internal_capacity) };
+        for (size_type pos: { childpos + 1, childpos - 1 }) {
+            if (pos > parent_size) continue; // also childpos - 1 for childpos 0
+            Node* neighbour{ parent->children[pos].load(std::memory_order_relaxed) };
+            uint64_t neighbour_version;
+            if (!neighbour || !neighbour->lock.read_lock(neighbour_version) || !parent->lock.validate(parent_version)) return Attempt::RESTART;
+            bool to_left{ pos < childpos };
+            Node* left{ to_left ? neighbour : node };
+            Node* right{ to_left ? node : neighbour };
+            size_type merged{ left->size.load(std::memory_order_relaxed) + right->size.load(std::memory_order_relaxed) };
+            if (node->type == NodeType::INTERNAL) ++merged; // the separator comes down
+            if (merged >= (node->type == NodeType::INTERNAL ? internal_capacity : leaf_capacity)) continue;
+
+            // succeeding upgrades also validate the sizes read above
+            if (!parent->lock.upgrade(parent_version)) return Attempt::RESTART;
+            if (!left->lock.upgrade(to_left ? neighbour_version : version)) {
+                parent->lock.unlock();
+                return Attempt::RESTART;
+            }
+            if (!right->lock.upgrade(to_left ? version : neighbour_version)) {
+                left->lock.unlock();
+                parent->lock.unlock();
+                return Attempt::RESTART;
+            }
+            size_type leftpos{ std::min(pos, childpos) };
+            if (node->type == NodeType::INTERNAL) {
+                static_cast<InternalNode*>(left)->merge(parent->values[leftpos], static_cast<InternalNode*>(right));
+            } else {
+                static_cast<ExternalNode*>(left)->merge(static_cast<ExternalNode*>(right));
+            }
+            parent->erase_at(leftpos);
+            left->lock.unlock();
+            parent->lock.unlock();
+            retire(right); // stays locked, everybody still holding it restarts
+            return Attempt::DONE;
+        }
+        return parent->lock.validate(parent_version) ? Attempt::NOTHING_TO_DO : Attempt::RESTART;
+    }
+
+    // one optimistic pass down to the leaf of key that merges the first underfull node on the path that fits
+    // into a neighbour, or replaces a root with a single child by that child
+    Attempt try_merge(const key_type& key) {
+        uint64_t version;
+        Node* node{ read_root(version) };
+        if (!node) return Attempt::RESTART;
+        if (node->type == NodeType::INTERNAL && node->size.load(std::memory_order_relaxed) == 0) {
+            if (!node->lock.upgrade(version)) return Attempt::RESTART;
+            if (root.load(std::memory_order_relaxed) != node) {
+                node->lock.unlock();
+                return Attempt::RESTART;
+            }
+            root.store(static_cast<InternalNode*>(node)->children[0].load(std::memory_order_relaxed), std::memory_order_release);
+            retire(node);
+            return Attempt::DONE;
+        }
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ internal->find_child_pos(key) };
+            Node* child{ internal->children[childpos].load(std::memory_order_relaxed) };
+            uint64_t child_version;
+            if (!child || !child->lock.read_lock(child_version) || !internal->lock.validate(version)) return Attempt::RESTART;
+            if (child->underfull()) {
+                Attempt attempt{ merge(internal, version, childpos, child, child_version) };
+                if (attempt != Attempt::NOTHING_TO_DO) return attempt;
+            }
+            node = child;
+            version = child_version;
+        }
+        return Attempt::NOTHING_TO_DO;
+    }
+
+public:
+    ADS_concurrent_set() : ADS_concurrent_set(Allocator()) {}
+
+    explicit ADS_concurrent_set(const Allocator& alloc) : internal_pool{ alloc }, external_pool{ alloc }, root{ nullptr } {
+        root.store(new_external(), std::memory_order_relaxed);
+    }
+
+    ADS_concurrent_set(std::initializer_list<key_type> ilist, const Allocator& alloc = Allocator()) : ADS_concurrent_set(alloc) {
+        for (const key_type& key: ilist) insert(key);
+    }
+
+    ADS_concurrent_set(const ADS_concurrent_set&) = delete;
+
+    ADS_concurrent_set& operator=(const ADS_concurrent_set&) = delete;
+
+    // keys are trivially destructible, the pools release all nodes at once
+    ~ADS_concurrent_set() = default;
+
+    [[nodiscard]] allocator_type get_allocator() const {
+        return internal_pool.get_allocator();
+    }
+
+    // number of keys, exact only while no writer is active
+    [[nodiscard]] size_type size() const {
+        return sz.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    // true if key was inserted, false if it was contained already
+    bool insert(const key_type& key) {
+        ads_detail::EpochGuard guard{ epochs };
+        while (true) {
+            Attempt attempt{ try_insert(key) };
+            if (attempt != Attempt::RESTART) return attempt == Attempt::DONE;
+            ads_detail::cpu_relax();
+        }
+    }
+
+    size_type erase(const key_type& key) {
+        ads_detail::EpochGuard guard{ epochs };
+        bool underfull{ false };
+        Attempt attempt;
+        while ((attempt = try_erase(key, underfull)) == Attempt::RESTART) {
+            ads_detail::cpu_relax();
+        }
+        if (attempt == Attempt::NOTHING_TO_DO) return 0;
+        while (underfull) { // merges may cascade upwards, every pass takes one
+            attempt = try_merge(key);
+            if (attempt == Attempt::RESTART) ads_detail::cpu_relax();
+            underfull = attempt != Attempt::NOTHING_TO_DO;
+        }
+        return 1;
+    }
+
+    [[nodiscard]] bool contains(const key_type& key) const {
+        ads_detail::EpochGuard guard{ epochs };
+        while (true) {
+            uint64_t version;
+            ExternalNode* leaf{ find_leaf(key, version) };
+            if (leaf) {
+                bool found{ leaf->holds_at(key, leaf->lower_pos(key)) };
+                if (leaf->lock.validate(version)) return found;
+            }
+            ads_detail::cpu_relax();
+        }
+    }
+
+    size_type count(const key_type& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    // calls visitor with every element in [lo, hi) in ascending order, returns the number of visited elements.
+    // a visitor returning bool stops the scan by returning false. every leaf is copied out and validated before
+    // its keys are visited, then the scan follows the leaf chain. if a leaf changed while it was read, the scan
+    // descends again to the last visited key. keys inserted or erased during the scan may or may not be visited,
+    // keys present throughout the scan are visited exactly once. nodes merged away meanwhile are not freed before
+    // the scan returns, a visitor that blocks for long holds back their memory
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) const {
+        if (!cmp(lo, hi)) return 0;
+        ads_detail::EpochGuard guard{ epochs };
+        key_type buffer[leaf_capacity];
+        key_type last{ lo };
+        bool started{ false }; // last has been visited, continue after it instead of at it
+        size_type visited{ 0 };
+        ExternalNode* leaf{ nullptr };
+        uint64_t version{ 0 };
+        while (true) {
+            if (!leaf) {
+                leaf = find_leaf(last, version);
+                if (!leaf) {
+                    ads_detail::cpu_relax();
+                    continue;
+                }
+            }
+            size_type size{ std::min(leaf->size.load(std::memory_order_relaxed), leaf_capacity) };
+            size_type pos{ started ? leaf->upper_pos(last) : leaf->lower_pos(last) };
+            size_type count{ 0 };
+            for (; pos < size && cmp(leaf->values[pos], hi); ++pos) {
+                buffer[count++] = leaf->values[pos];
+            }
+            bool done{ pos < size }; // reached hi
+            ExternalNode* next{ leaf->next.load(std::memory_order_relaxed) };
+            if (next) ads_detail::prefetch(next, sizeof(ExternalNode));
+            if (!leaf->lock.validate(version)) {
+                leaf = nullptr;
+                continue;
+            }
+            for (size_type i{ 0 }; i < count; ++i, ++visited) {
+                if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                    if (!visitor(static_cast<const key_type&>(buffer[i]))) return visited + 1;
+                } else {
+                    visitor(static_cast<const key_type&>(buffer[i]));
+                }
+            }
+            if (count > 0) {
+                last = buffer[count - 1];
+                started = true;
+            }
+            if (done || !next) break;
+            leaf = next->lock.read_lock(version) ? next : nullptr;
+        }
+        return visited;
+    }
+};
+
+template<typename Key, size_t N, typename Allocator>
+struct alignas(ads_detail::cache_line_size) ADS_concurrent_set<Key, N, Allocator>::Node {
+    mutable ads_detail::OptimisticLock lock;
+    NodeType type;
+    std::atomic<size_type> size{ 0 }; // read optimistically, written under the lock
+
+    explicit Node(NodeType _type) : type{ _type } {}
+
+    bool full() const {
+        return size.load(std::memory_order_relaxed) >= (type == NodeType::INTERNAL ? internal_capacity : leaf_capacity);
+    }
+
+    // below a quarter, so that the halves of a split are far from being merged again. an internal node with a
+    // single child and an empty leaf are always underfull
+    bool underfull() const {
+        size_type capacity{ type == NodeType::INTERNAL ? internal_capacity : leaf_capacity };
+        return size.load(std::memory_order_relaxed) < std::max<size_type>(1, capacity / 4);
+    }
+};
+
+template<typename Key, size_t N, typename Allocator>
+struct ADS_concurrent_set<Key, N, Allocator>::InternalNode : public Node {
+    static constexpr size_type M{ internal_capacity };
+    key_type values[M];
+    std::atomic<Node*> children[M + 1];
+
+    InternalNode() : Node(NodeType::INTERNAL) {
+        for (std::atomic<Node*>& child: children) {
+            child.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // the size may be torn while a writer is active, it is clamped so that optimistic reads stay in bounds
+    size_type find_child_pos(const key_type& elem) const {
+        size_type size{ std::min(this->size.load(std::memory_order_relaxed), M) };
+        if constexpr(std::is_arithmetic_v<key_type>) {
+            return ads_detail::sorted_rank<true>(values, size, elem);
+        } else {
+            return static_cast<size_type>(std::upper_bound(values, values + size, elem, cmp) - values);
+        }
+    }
+
+    // inserts elem at ins and right as the child right of it, there has to be room for one more child
+    void insert_at(const key_type& elem, size_type ins, Node* right) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        for (size_type i{ size }; i > ins; --i) {
+            values[i] = values[i - 1];
+            children[i + 1].store(children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        values[ins] = elem;
+        children[ins + 1].store(right, std::memory_order_relaxed);
+        this->size.store(size + 1, std::memory_order_relaxed);
+    }
+
+    // erases the key at and the child right of at
+    void erase_at(size_type at) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        for (size_type i{ at }; i + 1 < size; ++i) {
+            values[i] = values[i + 1];
+            children[i + 1].store(children[i + 2].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        this->size.store(size - 1, std::memory_order_relaxed);
+    }
+
+    // appends separator and everything of right, which is unlinked afterwards. the result has to fit
+    void merge(const key_type& separator, InternalNode* right) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        size_type right_size{ right->size.load(std::memory_order_relaxed) };
+        values[size] = separator;
+        for (size_type i{ 0 }; i < right_size; ++i) {
+            values[size + 1 + i] = right->values[i];
+        }
+        for (size_type i{ 0 }; i <= right_size; ++i) {
+            children[size + 1 + i].store(right->children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        this->size.store(size + 1 + right_size, std::memory_order_relaxed);
+    }
+
+    // moves the upper half to the empty node right, returns the index key for the parent
+    key_type split(InternalNode* right) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        size_type mid{ size / 2 };
+        for (size_type i{ mid + 1 }; i < size; ++i) {
+            right->values[i - mid - 1] = values[i];
+        }
+        for (size_type i{ mid + 1 }; i <= size; ++i) {
+            right->children[i - mid - 1].store(children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        right->size.store(size - mid - 1, std::memory_order_relaxed);
+        this->size.store(mid, std::memory_order_relaxed);
+        return values[mid];
+    }
+};
+
+template<typename Key, size_t N, typename Allocator>
+struct ADS_concurrent_set<Key, N, Allocator>::ExternalNode : public Node {
+    static constexpr size_type M{ leaf_capacity };
+    key_type values[M];
+    std::atomic<ExternalNode*> next;
+
+    explicit ExternalNode(ExternalNode* _next) : Node(NodeType::EXTERNAL), next{ _next } {}
+
+    // number of keys less than elem (or not greater than elem if upper), the size is clamped as above
+    template<bool upper = false>
+    size_type rank(const key_type& elem) const {
+        size_type size{ std::min(this->size.load(std::memory_order_relaxed), M) };
+        if constexpr(std::is_arithmetic_v<key_type>) {
+            return ads_detail::sorted_rank<upper>(values, size, elem);
+        } else if constexpr(upper) {
+            return static_cast<size_type>(std::upper_bound(values, values + size, elem, cmp) - values);
+        } else {
+            return static_cast<size_type>(std::lower_bound(values, values + size, elem, cmp) - values);
+        }
+    }
+
+    size_type lower_pos(const key_type& elem) const {
+        return rank<false>(elem);
+    }
+
+    size_type upper_pos(const key_type& elem) const {
+        return rank<true>(elem);
+    }
+
+    // whether elem is at pos, which came from lower_pos
+    bool holds_at(const key_type& elem, size_type pos) const {
+        return pos < std::min(this->size.load(std::memory_order_relaxed), M) && !cmp(elem, values[pos]);
+    }
+
+    // there has to be room for one more key
+    void insert_at(const key_type& elem, size_type ins) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        std::copy_backward(values + ins, values + size, values + size + 1);
+        values[ins] = elem;
+        this->size.store(size + 1, std::memory_order_relaxed);
+    }
+
+    void erase_at(size_type at) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        std::copy(values + at + 1, values + size, values + at);
+        this->size.store(size - 1, std::memory_order_relaxed);
+    }
+
+    // appends the keys of right, the next leaf, and takes its place in the leaf chain. the result has to fit
+    void merge(ExternalNode* right) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        size_type right_size{ right->size.load(std::memory_order_relaxed) };
+        std::copy(right->values, right->values + right_size, values + size);
+        this->size.store(size + right_size, std::memory_order_relaxed);
+        next.store(right->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // moves the upper half to the empty node right (linked to next already), returns its first key
+    key_type split(ExternalNode* right) {
+        size_type size{ this->size.load(std::memory_order_relaxed) };
+        size_type mid{ size / 2 };
+        std::copy(values + mid, values + size, right->values);
+        right->size.store(size - mid, std::memory_order_relaxed);
+        this->size.store(mid, std::memory_order_relaxed);
+        next.store(right, std::memory_order_relaxed);
+        return right->values[0];
+    }
+};
+
+#endif
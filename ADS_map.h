@@ -0,0 +1,664 @@
+#ifndef ADS_MAP_H
+#define ADS_MAP_H
+
+#include "ADS_set.h"
+
+// ordered map on the node layout of ADS_set. leaves keep keys and values in two parallel arrays (structure of
+// arrays) and internal nodes keys only, so a search reads nothing but keys and the values of a leaf are only
+// touched once the key is found. values are updated where they are (operator[], insert_or_assign and the
+// iterators), which never moves a key. keys and values have to be default constructible and move assignable,
+// the node arrays hold them by value. Compare has to be stateless like the one of ADS_set, a transparent one
+// enables the heterogeneous lookups. there is no stored pair to refer to: like std::flat_map, the iterators
+// yield std::pair<const Key&, Value&>
+template<typename Key, typename Value, size_t N = 0, typename Allocator = std::allocator<std::pair<const Key, Value>>,
+         typename Compare = std::less<Key>>
+class ADS_map {
+public:
+    template<bool Const>
+    class Iterator;
+
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<key_type, mapped_type>;
+    using reference = std::pair<const key_type&, mapped_type&>;
+    using const_reference = std::pair<const key_type&, const mapped_type&>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+
+    // maximum number of keys per node (the minimum is half of it). N == 0 derives them from ADS_node_size<Key>,
+    // a leaf slot holds a key and a value
+    static constexpr size_type internal_capacity{ N ? 2 * N : ads_detail::internal_capacity(sizeof(Key), ADS_node_size<Key>::internal_bytes) };
+    static constexpr size_type leaf_capacity{ N ? 2 * N : ads_detail::leaf_capacity(sizeof(Key) + sizeof(Value), ADS_node_size<Key>::leaf_bytes) };
+
+private:
+    // internal nodes are those of ads_detail, leaves are the map's own
+    using NodeType = ads_detail::NodeType;
+    using Node = ads_detail::TreeNode;
+    using InternalNode = ads_detail::IndexNode<key_type, internal_capacity>;
+    struct ExternalNode;
+    using Nodes = ads_detail::NodePools<InternalNode, ExternalNode, Allocator>;
+    using link = Node*;
+
+    struct PathEntry {
+        InternalNode* node;
+        size_type childpos;
+    };
+    static constexpr size_type max_height{ std::numeric_limits<size_type>::digits };
+
+    static_assert(std::is_empty_v<key_compare> && std::is_default_constructible_v<key_compare>, "ADS_map needs a stateless comparator");
+    static constexpr key_compare cmp{};
+
+    // arithmetic keys in ascending order are searched with ads_detail::sorted_rank, everything else binary
+    static constexpr bool arithmetic_search{ std::is_arithmetic_v<key_type> && (std::is_same_v<key_compare, std::less<key_type>> || std::is_same_v<key_compare, std::less<>>) };
+
+    // see ADS_set::lookup_key
+    template<typename K, typename C = key_compare>
+    using lookup_key = std::enable_if_t<std::is_same_v<K, key_type> || ads_detail::is_transparent<C>::value, int>;
+
+    Nodes nodes;
+    link root;
+    size_type sz{ 0 };
+
+    // number of keys in the sorted range [keys, keys + size) that are less than key, or not greater than key if upper
+    template<bool upper, typename K>
+    static size_type key_rank(const key_type* keys, size_type size, const K& key) {
+        if constexpr(arithmetic_search && std::is_same_v<K, key_type>) {
+            return ads_detail::sorted_rank<upper>(keys, size, key);
+        } else if constexpr(upper) {
+            return static_cast<size_type>(std::upper_bound(keys, keys + size, key, cmp) - keys);
+        } else {
+            return static_cast<size_type>(std::lower_bound(keys, keys + size, key, cmp) - keys);
+        }
+    }
+
+    // builds a tree bottom-up from count entries with sorted, unique keys starting at first. the entries are
+    // pairs (or pairs of references) of a key and a value, which are moved from if first yields rvalues
+    template<typename ForwardIt>
+    link build_tree(ForwardIt first, size_type count) {
+        if (count == 0) return nodes.new_leaf();
+
+        // leaf level, linked left to right
+        size_type leaves{ (count + ExternalNode::M - 1) / ExternalNode::M };
+        std::vector<link> level;
+        std::vector<const key_type*> mins; // smallest key below each node of level
+        level.reserve(leaves);
+        mins.reserve(leaves);
+        ExternalNode* prev{ nullptr };
+        for (size_type i{ 0 }; i < leaves; ++i) {
+            ExternalNode* leaf{ nodes.new_leaf() };
+            leaf->size = count / leaves + (i < count % leaves ? 1 : 0);
+            for (size_type j{ 0 }; j < leaf->size; ++j, ++first) {
+                auto&& entry{ *first };
+                leaf->keys[j] = std::forward<decltype(entry)>(entry).first;
+                leaf->values[j] = std::forward<decltype(entry)>(entry).second;
+            }
+            if (prev) prev->next = leaf;
+            prev = leaf;
+            level.push_back(leaf);
+            mins.push_back(leaf->keys);
+        }
+        return ads_detail::build_index(level, mins, [this] { return nodes.new_internal(); });
+    }
+
+    ExternalNode* first_leaf() const {
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            node = static_cast<InternalNode*>(node)->children[0];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    template<typename K>
+    ExternalNode* find_leaf(const K& key) const {
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            node = internal->children[key_rank<true>(internal->keys, internal->size, key)]; // keys equal to a separator live right of it
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // descends to the leaf responsible for key, recording the internal nodes on the way in path
+    template<typename K>
+    ExternalNode* find_leaf(const K& key, PathEntry* path, size_type& depth) const {
+        link node{ root };
+        depth = 0;
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ key_rank<true>(internal->keys, internal->size, key) };
+            path[depth++] = PathEntry{ internal, childpos };
+            node = internal->children[childpos];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // position of key in leaf, leaf->size if it is not there
+    template<typename K>
+    static size_type leaf_pos(const ExternalNode* leaf, const K& key) {
+        size_type pos{ key_rank<false>(leaf->keys, leaf->size, key) };
+        return pos < leaf->size && !cmp(key, leaf->keys[pos]) ? pos : leaf->size;
+    }
+
+    // iterator to position pos of leaf, pos == size continues at the first element of the next leaf
+    static iterator leaf_iterator(ExternalNode* leaf, size_type pos) {
+        if (pos < leaf->size) return iterator(leaf, pos);
+        return leaf->next ? iterator(leaf->next, 0) : iterator();
+    }
+
+    // see ADS_set::split_position
+    static size_type split_position(size_type size, bool append) {
+        return append ? size - 1 - std::max<size_type>(1, size / 10) : (size - 1) / 2;
+    }
+
+    // value direct initialized from args, value initialized without any
+    template<typename... Args>
+    static mapped_type make_value(Args&&... args) {
+        if constexpr(sizeof...(Args) == 0) {
+            return mapped_type();
+        } else {
+            mapped_type value(std::forward<Args>(args)...);
+            return value;
+        }
+    }
+
+    // the entry of key, which is inserted with a value constructed from args if it is missing. returns the
+    // iterator to the entry and whether it was inserted. existing entries are not touched, args are not used then
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> try_insert(K&& key, Args&&... args) {
+        if (root == Nodes::empty_root()) root = nodes.new_leaf();
+        PathEntry path[max_height];
+        size_type depth;
+        ExternalNode* leaf{ find_leaf(key, path, depth) };
+        size_type pos{ key_rank<false>(leaf->keys, leaf->size, key) };
+        if (pos < leaf->size && !cmp(key, leaf->keys[pos])) return std::pair<iterator, bool>(iterator(leaf, pos), false);
+        leaf->insert_at(pos, std::forward<K>(key), make_value(std::forward<Args>(args)...));
+        ++sz;
+        if (leaf->size <= ExternalNode::M) return std::pair<iterator, bool>(iterator(leaf, pos), true);
+
+        // split upwards as long as the nodes on the path are temporarily invalid, ascending inserts into the last
+        // leaf split near its end like in ADS_set
+        bool append{ !leaf->next && pos > split_position(leaf->size, true) };
+        size_type split_at{ split_position(leaf->size, append) };
+        ExternalNode* right{ nodes.new_leaf(leaf->next) };
+        leaf->split(split_at, right);
+        iterator inserted{ pos <= split_at ? iterator(leaf, pos) : iterator(right, pos - split_at - 1) };
+        key_type separator{ right->keys[0] };
+        link child{ right };
+        while (depth > 0) {
+            PathEntry& parent{ path[--depth] };
+            parent.node->insert_at(std::move(separator), parent.childpos);
+            parent.node->children[parent.childpos + 1] = child;
+            if (parent.node->size <= InternalNode::M) return std::pair<iterator, bool>(inserted, true);
+            InternalNode* sibling{ nodes.new_internal() };
+            separator = parent.node->split(split_position(parent.node->size, append), sibling);
+            child = sibling;
+        }
+        TRACE_DEB("Insert triggered root split")
+        InternalNode* new_root{ nodes.new_internal() };
+        new_root->size = 1;
+        new_root->keys[0] = std::move(separator);
+        new_root->children[0] = root;
+        new_root->children[1] = child;
+        root = new_root;
+        return std::pair<iterator, bool>(inserted, true);
+    }
+
+    // rebalances the underfull child (of type Child) path[level] leads to, see ads_detail::rebalance
+    template<typename Child>
+    void rebalance(PathEntry* path, size_type level) {
+        if (Child* emptied{ ads_detail::rebalance<Child>(path[level].node, path[level].childpos) }) nodes.free_node(emptied);
+    }
+
+public:
+    ADS_map() : ADS_map(Allocator()) {}
+
+    explicit ADS_map(const Allocator& alloc) : nodes{ alloc }, root{ nullptr } {
+        root = nodes.new_leaf();
+    }
+
+    ADS_map(std::initializer_list<value_type> ilist, const Allocator& alloc = Allocator())
+            : ADS_map(ilist.begin(), ilist.end(), alloc) {}
+
+    // of several entries with the same key the first one is kept, as with repeated inserts
+    template<typename InputIt>
+    ADS_map(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+            : nodes{ alloc }, root{ nullptr } {
+        std::vector<value_type> entries(first, last);
+        std::stable_sort(entries.begin(), entries.end(), [](const value_type& lhs, const value_type& rhs) { return cmp(lhs.first, rhs.first); });
+        entries.erase(std::unique(entries.begin(), entries.end(), [](const value_type& lhs, const value_type& rhs) { return !cmp(lhs.first, rhs.first); }),
+                      entries.end());
+        root = build_tree(std::make_move_iterator(entries.begin()), entries.size());
+        sz = entries.size();
+    }
+
+    // the iterator of other already yields sorted, unique keys
+    ADS_map(const ADS_map& other)
+            : nodes{ std::allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator()) },
+              root{ nullptr },
+              sz{ other.sz } {
+        root = build_tree(other.begin(), other.sz);
+    }
+
+    ADS_map(ADS_map&& other) noexcept
+            : nodes{ std::move(other.nodes) },
+              root{ other.root },
+              sz{ other.sz } {
+        other.root = Nodes::empty_root();
+        other.sz = 0;
+    }
+
+    ~ADS_map() {
+        nodes.release(root);
+    }
+
+    ADS_map& operator=(const ADS_map& other) {
+        if (this != &other) {
+            ADS_map copy{ other };
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ADS_map& operator=(ADS_map&& other) noexcept {
+        if (this != &other) {
+            ADS_map moved{ std::move(other) };
+            swap(moved);
+        }
+        return *this;
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const {
+        return nodes.get_allocator();
+    }
+
+    [[nodiscard]] size_type size() const {
+        return sz;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return sz == 0;
+    }
+
+    void clear() {
+        nodes.release(root);
+        root = nodes.new_leaf();
+        sz = 0;
+    }
+
+    // the value of key, value initialized and inserted first if key is missing
+    mapped_type& operator[](const key_type& key) {
+        iterator it{ try_insert(key).first };
+        return it.current->values[it.pos];
+    }
+
+    mapped_type& operator[](key_type&& key) {
+        iterator it{ try_insert(std::move(key)).first };
+        return it.current->values[it.pos];
+    }
+
+    // the value of key, throws std::out_of_range if key is missing
+    mapped_type& at(const key_type& key) {
+        ExternalNode* leaf{ find_leaf(key) };
+        size_type pos{ leaf_pos(leaf, key) };
+        if (pos == leaf->size) throw std::out_of_range("ADS_map::at: key not found");
+        return leaf->values[pos];
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        return const_cast<ADS_map*>(this)->at(key);
+    }
+
+    // inserts key with a value constructed from args if key is missing, otherwise nothing happens (args are
+    // not moved from). returns the iterator to the entry of key and whether it was inserted
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+        return try_insert(key, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+        return try_insert(std::move(key), std::forward<Args>(args)...);
+    }
+
+    // inserts key with value, or assigns value to the entry of key in place
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value) {
+        std::pair<iterator, bool> result{ try_insert(key, std::forward<M>(value)) };
+        if (!result.second) result.first.current->values[result.first.pos] = std::forward<M>(value);
+        return result;
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value) {
+        std::pair<iterator, bool> result{ try_insert(std::move(key), std::forward<M>(value)) };
+        if (!result.second) result.first.current->values[result.first.pos] = std::forward<M>(value);
+        return result;
+    }
+
+    // inserts the entry if its key is missing, like std::map::insert
+    std::pair<iterator, bool> insert(const value_type& entry) {
+        return try_insert(entry.first, entry.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& entry) {
+        return try_insert(std::move(entry.first), std::move(entry.second));
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        if (sz == 0) {
+            ADS_map built{ first, last, get_allocator() };
+            swap(built);
+            return;
+        }
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> ilist) {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    size_type erase(const key_type& key) {
+        return erase<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    size_type erase(const K& key) {
+        PathEntry path[max_height];
+        size_type depth;
+        ExternalNode* leaf{ find_leaf(key, path, depth) };
+        size_type pos{ leaf_pos(leaf, key) };
+        if (pos == leaf->size) return 0;
+        leaf->erase_at(pos);
+        --sz;
+
+        // merge upwards as long as the nodes on the path are temporarily invalid
+        if (depth > 0 && leaf->size < ExternalNode::min_size) {
+            rebalance<ExternalNode>(path, depth - 1);
+            for (--depth; depth > 0 && path[depth].node->size < InternalNode::min_size; --depth) {
+                rebalance<InternalNode>(path, depth - 1);
+            }
+        }
+        if (root->size == 0 && root->type == NodeType::INTERNAL) {
+            TRACE_DEB("Erase triggered root merge")
+            link old_root{ root };
+            root = static_cast<InternalNode*>(root)->children[0];
+            nodes.free_node(old_root);
+        }
+        return 1;
+    }
+
+    size_type count(const key_type& key) const {
+        return count<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    size_type count(const K& key) const {
+        ExternalNode* leaf{ find_leaf(key) };
+        return leaf_pos(leaf, key) < leaf->size ? 1 : 0;
+    }
+
+    iterator find(const key_type& key) {
+        return find<key_type>(key);
+    }
+
+    const_iterator find(const key_type& key) const {
+        return find<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    iterator find(const K& key) {
+        ExternalNode* leaf{ find_leaf(key) };
+        size_type pos{ leaf_pos(leaf, key) };
+        if (pos == leaf->size) return end();
+        return iterator(leaf, pos);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    const_iterator find(const K& key) const {
+        return const_cast<ADS_map*>(this)->find(key);
+    }
+
+    // first entry whose key is not less than key
+    iterator lower_bound(const key_type& key) {
+        return lower_bound<key_type>(key);
+    }
+
+    const_iterator lower_bound(const key_type& key) const {
+        return lower_bound<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    iterator lower_bound(const K& key) {
+        ExternalNode* leaf{ find_leaf(key) };
+        return leaf_iterator(leaf, key_rank<false>(leaf->keys, leaf->size, key));
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    const_iterator lower_bound(const K& key) const {
+        return const_cast<ADS_map*>(this)->lower_bound(key);
+    }
+
+    // first entry whose key is greater than key
+    iterator upper_bound(const key_type& key) {
+        return upper_bound<key_type>(key);
+    }
+
+    const_iterator upper_bound(const key_type& key) const {
+        return upper_bound<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    iterator upper_bound(const K& key) {
+        ExternalNode* leaf{ find_leaf(key) };
+        return leaf_iterator(leaf, key_rank<true>(leaf->keys, leaf->size, key));
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    const_iterator upper_bound(const K& key) const {
+        return const_cast<ADS_map*>(this)->upper_bound(key);
+    }
+
+    iterator begin() {
+        ExternalNode* leaf{ first_leaf() };
+        if (leaf->size == 0) return end();
+        return iterator(leaf, 0);
+    }
+
+    const_iterator begin() const {
+        return const_cast<ADS_map*>(this)->begin();
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    iterator end() {
+        return iterator();
+    }
+
+    const_iterator end() const {
+        return const_iterator();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    void swap(ADS_map& other) {
+        nodes.swap(other.nodes);
+        std::swap(root, other.root);
+        std::swap(sz, other.sz);
+    }
+
+    // equal keys (equivalent under Compare) mapped to equal values
+    bool operator==(const ADS_map& rhs) const {
+        if (sz != rhs.sz) return false;
+        for (const_iterator itl{ begin() }, itr{ rhs.begin() }; itl != end(); ++itl, ++itr) {
+            const_reference l{ *itl };
+            const_reference r{ *itr };
+            if (cmp(l.first, r.first) || cmp(r.first, l.first) || !(l.second == r.second)) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const ADS_map& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+// operator* pairs references into the two arrays of a leaf, there is no pair to point to: operator-> returns
+// a proxy holding the pair (see the note on the iterator of ADS_set). iterators convert to const_iterators
+template<typename Key, typename Value, size_t N, typename Allocator, typename Compare>
+template<bool Const>
+class ADS_map<Key, Value, N, Allocator, Compare>::Iterator {
+    friend class ADS_map; // operator[] and insert_or_assign write through current
+    friend class Iterator<!Const>;
+
+public:
+    using value_type = std::pair<Key, Value>;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<Const, const_reference, ADS_map::reference>;
+    using iterator_category = std::input_iterator_tag;
+
+    struct pointer {
+        reference entry;
+
+        const reference* operator->() const {
+            return &entry;
+        }
+    };
+
+private:
+    ExternalNode* current;
+    size_type pos;
+
+public:
+    Iterator() : current{ nullptr }, pos{ 0 } {}
+
+    explicit Iterator(ExternalNode* _current, size_type _pos) : current{ _current }, pos{ _pos } {}
+
+    template<bool C = Const, std::enable_if_t<C, int> = 0>
+    Iterator(const Iterator<false>& other) : current{ other.current }, pos{ other.pos } {}
+
+    reference operator*() const {
+        return reference(current->keys[pos], current->values[pos]);
+    }
+
+    pointer operator->() const {
+        return pointer{ **this };
+    }
+
+    Iterator& operator++() {
+        if (current) {
+            if (pos + 1 == current->size) {
+                current = current->next;
+                pos = 0;
+            } else {
+                ++pos;
+            }
+        }
+        return *this;
+    }
+
+    Iterator operator++(int) {
+        Iterator old{ *this };
+        this->operator++();
+        return old;
+    }
+
+    template<bool C>
+    bool operator==(const Iterator<C>& rhs) const {
+        return current == rhs.current && pos == rhs.pos;
+    }
+
+    template<bool C>
+    bool operator!=(const Iterator<C>& rhs) const {
+        return current != rhs.current || pos != rhs.pos;
+    }
+};
+
+// keys[i] maps to values[i]. every operation that moves entries moves both arrays alike
+template<typename Key, typename Value, size_t N, typename Allocator, typename Compare>
+struct ADS_map<Key, Value, N, Allocator, Compare>::ExternalNode : public Node {
+    static constexpr size_type M{ leaf_capacity };
+    static constexpr size_type min_size{ M / 2 };
+    ExternalNode* next;
+    key_type keys[M + 1]; // temporary invalid nodes require + 1
+    mapped_type values[M + 1];
+
+    explicit ExternalNode(ExternalNode* _next = nullptr) : Node(NodeType::EXTERNAL, 0), next{ _next } {}
+
+    // not safe if size >= M + 1
+    template<typename K>
+    void insert_at(size_type ins, K&& key, mapped_type&& value) {
+        std::move_backward(keys + ins, keys + this->size, keys + this->size + 1);
+        std::move_backward(values + ins, values + this->size, values + this->size + 1);
+        keys[ins] = std::forward<K>(key);
+        values[ins] = std::move(value);
+        ++this->size;
+    }
+
+    void erase_at(size_type at) {
+        std::move(keys + at + 1, keys + this->size, keys + at);
+        std::move(values + at + 1, values + this->size, values + at);
+        --this->size;
+    }
+
+    // right is an empty node linked to next, it gets everything after split_at
+    void split(size_type split_at, ExternalNode* right) {
+        right->size = this->size - split_at - 1;
+        std::move(keys + split_at + 1, keys + this->size, right->keys);
+        std::move(values + split_at + 1, values + this->size, right->values);
+        this->size = split_at + 1;
+        next = right;
+    }
+
+    // moves the last count entries of left (the left neighbour) to the front, separator becomes the new first key
+    void borrow_left(key_type& separator, ExternalNode* left, size_type count) {
+        std::move_backward(keys, keys + this->size, keys + this->size + count);
+        std::move_backward(values, values + this->size, values + this->size + count);
+        std::move(left->keys + left->size - count, left->keys + left->size, keys);
+        std::move(left->values + left->size - count, left->values + left->size, values);
+        left->size -= count;
+        this->size += count;
+        separator = keys[0];
+    }
+
+    // appends the first count entries of right (the right neighbour), separator becomes its new first key
+    void borrow_right(key_type& separator, ExternalNode* right, size_type count) {
+        std::move(right->keys, right->keys + count, keys + this->size);
+        std::move(right->values, right->values + count, values + this->size);
+        std::move(right->keys + count, right->keys + right->size, right->keys);
+        std::move(right->values + count, right->values + right->size, right->values);
+        right->size -= count;
+        this->size += count;
+        separator = right->keys[0];
+    }
+
+    // appends all entries of neighbour, the next leaf. the index key between them is dropped by the parent
+    void merge(key_type&, ExternalNode* neighbour) {
+        std::move(neighbour->keys, neighbour->keys + neighbour->size, keys + this->size);
+        std::move(neighbour->values, neighbour->values + neighbour->size, values + this->size);
+        this->size += neighbour->size;
+        next = neighbour->next;
+    }
+};
+
+template<typename Key, typename Value, size_t N, typename Allocator, typename Compare>
+void swap(ADS_map<Key, Value, N, Allocator, Compare>& lhs, ADS_map<Key, Value, N, Allocator, Compare>& rhs) {
+    lhs.swap(rhs);
+}
+
+#endif
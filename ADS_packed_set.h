@@ -0,0 +1,768 @@
+#ifndef ADS_PACKED_SET_H
+#define ADS_PACKED_SET_H
+
+#include "ADS_set.h"
+
+// ordered set of integers with compressed leaves (frame of reference). a leaf stores its keys as deltas to a
+// base value, all of one width of 1, 2, 4 or 8 bytes: the smallest one the key span of the leaf fits in.
+// dense keys (ids, offsets, timestamps) take 1 or 2 bytes instead of sizeof(Key), a leaf of the same size
+// holds several times the keys and scans touch that much fewer cache lines. lookups search the deltas in
+// place with the kernels of ADS_set, only the needle is translated. a leaf is repacked when an insert does
+// not fit its base or width, or it is full. the keys are not stored anywhere as key_type, so the iterator
+// yields them by value
+template<typename Key, typename Allocator = std::allocator<Key>>
+class ADS_packed_set {
+public:
+    class Iterator;
+
+    using value_type = Key;
+    using key_type = Key;
+    using reference = value_type;
+    using const_reference = value_type;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+    using key_compare = std::less<key_type>;
+    using allocator_type = Allocator;
+
+    static_assert(std::is_integral_v<key_type> && !std::is_same_v<key_type, bool>, "ADS_packed_set needs an integral key type");
+
+    // same node sizes as ADS_set, see ADS_node_size. leaves have no fixed key capacity, it depends on the width
+    static constexpr size_type internal_capacity{ ads_detail::internal_capacity(sizeof(Key), ADS_node_size<Key>::internal_bytes) };
+
+private:
+    // keys in an order preserving unsigned encoding, which is what nodes store and compare
+    using word = std::make_unsigned_t<key_type>;
+
+    enum class NodeType : unsigned char {
+        INTERNAL,
+        EXTERNAL
+    };
+    struct Node;
+    struct InternalNode;
+    struct ExternalNode;
+    using link = Node*;
+
+    struct PathEntry {
+        InternalNode* node;
+        size_type childpos;
+    };
+    static constexpr size_type max_height{ std::numeric_limits<size_type>::digits };
+
+    // bytes of a leaf left for its deltas after the header (tag, size, next, base, width)
+    static constexpr size_type delta_bytes{ ads_detail::cache_lines(ADS_node_size<Key>::leaf_bytes) - 2 * sizeof(size_type) - sizeof(void*) - 2 * sizeof(uint64_t) };
+
+    // flipping the sign bit maps signed keys monotonically onto the unsigned range
+    static constexpr word sign_flip{ std::is_signed_v<key_type> ? static_cast<word>(word{ 1 } << (std::numeric_limits<word>::digits - 1)) : word{ 0 } };
+
+    static constexpr key_compare cmp{};
+
+    ads_detail::NodePool<InternalNode, Allocator> internal_pool;
+    ads_detail::NodePool<ExternalNode, Allocator> external_pool;
+    link root;
+    size_type sz{ 0 };
+    // keys of one or two leaves decoded for repacking. a member rather than a stack array, as leaves of
+    // single byte deltas hold a key per byte and a page sized ADS_node_size would take that much stack
+    std::vector<word> scratch;
+
+    static word encode(key_type key) {
+        return static_cast<word>(static_cast<word>(key) ^ sign_flip);
+    }
+
+    static key_type decode(word value) {
+        return static_cast<key_type>(static_cast<word>(value ^ sign_flip));
+    }
+
+    InternalNode* new_internal() {
+        return new(internal_pool.allocate()) InternalNode();
+    }
+
+    ExternalNode* new_external(ExternalNode* next = nullptr) {
+        return new(external_pool.allocate()) ExternalNode(next);
+    }
+
+    // root of moved-from sets, never written to, the first insert replaces it (see ADS_set::empty_root)
+    static ExternalNode* empty_root() {
+        static ExternalNode leaf;
+        return &leaf;
+    }
+
+    void free_node(link node) {
+        if (node->type == NodeType::INTERNAL) {
+            internal_pool.deallocate(static_cast<InternalNode*>(node));
+        } else {
+            external_pool.deallocate(static_cast<ExternalNode*>(node));
+        }
+    }
+
+    // the split of the sorted keys [keys, keys + count) closest to the middle that leaves two fitting leaves.
+    // there is one whenever the keys come from two fitting leaves, or from one fitting leaf and one more key
+    static size_type split_point(const word* keys, size_type count) {
+        size_type mid{ count / 2 };
+        for (size_type offset{ 0 }; offset <= mid; ++offset) {
+            for (size_type at: { mid - offset, mid + offset }) {
+                if (at > 0 && at < count && ExternalNode::fits(keys, at) && ExternalNode::fits(keys + at, count - at)) return at;
+            }
+        }
+        return mid;
+    }
+
+    ExternalNode* first_leaf() const {
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            node = static_cast<InternalNode*>(node)->children[0];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // all keys in ascending order, decoded leaf by leaf
+    std::vector<word> words() const {
+        std::vector<word> keys(sz);
+        word* out{ keys.data() };
+        for (ExternalNode* leaf{ sz ? first_leaf() : nullptr }; leaf; leaf = leaf->next) {
+            leaf->unpack(out);
+            out += leaf->size;
+        }
+        return keys;
+    }
+
+    // packs the sorted, unique keys into as few leaves as they fit in, the index levels above are built in one
+    // pass each with the children spread evenly over the nodes
+    link build_tree(const std::vector<word>& keys) {
+        if (keys.empty()) return new_external();
+        std::vector<link> level;
+        std::vector<word> firsts; // smallest key below each node of level
+        ExternalNode* prev{ nullptr };
+        for (size_type i{ 0 }; i < keys.size();) {
+            size_type count{ 1 };
+            while (i + count < keys.size() && ExternalNode::fits(keys.data() + i, count + 1)) ++count;
+            ExternalNode* leaf{ new_external() };
+            leaf->pack(keys.data() + i, count);
+            if (prev) prev->next = leaf;
+            prev = leaf;
+            level.push_back(leaf);
+            firsts.push_back(keys[i]);
+            i += count;
+        }
+        std::vector<link> parents;
+        std::vector<word> parent_firsts;
+        while (level.size() > 1) {
+            size_type nodes{ (level.size() + InternalNode::M) / (InternalNode::M + 1) };
+            parents.clear();
+            parent_firsts.clear();
+            for (size_type n{ 0 }, done{ 0 }; n < nodes; ++n) {
+                size_type children{ (level.size() - done) / (nodes - n) };
+                InternalNode* node{ new_internal() };
+                node->size = children - 1;
+                for (size_type c{ 0 }; c < children; ++c) {
+                    node->children[c] = level[done + c];
+                    if (c > 0) node->values[c - 1] = firsts[done + c];
+                }
+                parents.push_back(node);
+                parent_firsts.push_back(firsts[done]);
+                done += children;
+            }
+            level.swap(parents);
+            firsts.swap(parent_firsts);
+        }
+        return level[0];
+    }
+
+    ExternalNode* find_leaf(word key) const {
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            node = internal->children[internal->find_child_pos(key)];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // descends to the leaf responsible for key, recording the internal nodes on the way in path
+    ExternalNode* find_leaf(word key, PathEntry* path, size_type& depth) const {
+        link node{ root };
+        depth = 0;
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ internal->find_child_pos(key) };
+            path[depth++] = PathEntry{ internal, childpos };
+            node = internal->children[childpos];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // iterator to position pos of leaf, pos == size continues at the first key of the next leaf
+    static iterator leaf_iterator(ExternalNode* leaf, size_type pos) {
+        if (pos < leaf->size) return Iterator(leaf, pos);
+        return leaf->next ? Iterator(leaf->next, 0) : Iterator();
+    }
+
+    std::pair<iterator, bool> insert_unique(word key) {
+        if (root == empty_root()) root = new_external();
+        PathEntry path[max_height];
+        size_type depth;
+        ExternalNode* leaf{ find_leaf(key, path, depth) };
+        size_type pos{ leaf->template rank<false>(key) };
+        if (pos < leaf->size && leaf->key_at(pos) == key) return std::pair<iterator, bool>(Iterator(leaf, pos), false);
+        if (leaf->insert_at(key, pos)) {
+            ++sz;
+            return std::pair<iterator, bool>(Iterator(leaf, pos), true);
+        }
+
+        // repack with the new base or width, split if the keys do not fit into one leaf at their width
+        scratch.resize(leaf->size + 1);
+        word* keys{ scratch.data() };
+        leaf->unpack(keys);
+        std::copy_backward(keys + pos, keys + leaf->size, keys + leaf->size + 1);
+        keys[pos] = key;
+        size_type count{ leaf->size + 1 };
+        if (ExternalNode::fits(keys, count)) {
+            TRACE_DEB("Insert repacked leaf")
+            leaf->pack(keys, count);
+            ++sz;
+            return std::pair<iterator, bool>(Iterator(leaf, pos), true);
+        }
+        size_type at{ split_point(keys, count) };
+        ExternalNode* right{ new_external(leaf->next) };
+        leaf->pack(keys, at);
+        right->pack(keys + at, count - at);
+        leaf->next = right;
+        ++sz;
+        insert_child(path, depth, keys[at], right);
+        return std::pair<iterator, bool>(pos < at ? Iterator(leaf, pos) : Iterator(right, pos - at), true);
+    }
+
+    // links right, split off the node path[depth - 1] leads to, into the parent with separator as its index
+    // key, and splits upwards as long as the nodes on the path overflow
+    void insert_child(PathEntry* path, size_type depth, word separator, link right) {
+        while (depth > 0) {
+            PathEntry& parent{ path[--depth] };
+            parent.node->insert_at(separator, parent.childpos);
+            parent.node->children[parent.childpos + 1] = right;
+            if (parent.node->size <= InternalNode::M) return;
+            InternalNode* sibling{ new_internal() };
+            separator = parent.node->split((parent.node->size - 1) / 2, sibling);
+            right = sibling;
+        }
+        TRACE_DEB("Insert triggered root split")
+        InternalNode* new_root{ new_internal() };
+        new_root->size = 1;
+        new_root->values[0] = separator;
+        new_root->children[0] = root;
+        new_root->children[1] = right;
+        root = new_root;
+    }
+
+    // an underfull leaf is merged with a neighbour if both fit into one leaf together, otherwise the keys of
+    // both are split anew closer to the middle. leaves below min_size can remain this way, but only next to a
+    // neighbour they do not fit in with, which is at least half full then
+    void rebalance_leaf(PathEntry* path, size_type level) {
+        InternalNode* parent{ path[level].node };
+        size_type leftpos{ path[level].childpos > 0 ? path[level].childpos - 1 : 0 };
+        ExternalNode* left{ static_cast<ExternalNode*>(parent->children[leftpos]) };
+        ExternalNode* right{ static_cast<ExternalNode*>(parent->children[leftpos + 1]) };
+        scratch.resize(left->size + right->size);
+        word* keys{ scratch.data() };
+        left->unpack(keys);
+        right->unpack(keys + left->size);
+        size_type count{ left->size + right->size };
+        if (ExternalNode::fits(keys, count)) {
+            left->pack(keys, count);
+            left->next = right->next;
+            free_node(right);
+            parent->erase_at(leftpos);
+        } else {
+            size_type at{ split_point(keys, count) };
+            left->pack(keys, at);
+            right->pack(keys + at, count - at);
+            parent->values[leftpos] = keys[at];
+        }
+    }
+
+    // restores the minimum size of the internal node path[level] leads to, like ADS_set::rebalance
+    void rebalance_internal(PathEntry* path, size_type level) {
+        InternalNode* parent{ path[level].node };
+        size_type childpos{ path[level].childpos };
+        InternalNode* child{ static_cast<InternalNode*>(parent->children[childpos]) };
+        InternalNode* left{ childpos > 0 ? static_cast<InternalNode*>(parent->children[childpos - 1]) : nullptr };
+        InternalNode* right{ childpos < parent->size ? static_cast<InternalNode*>(parent->children[childpos + 1]) : nullptr };
+        bool from_left{ left && (!right || left->size >= right->size) };
+        InternalNode* neighbour{ from_left ? left : right };
+        if (neighbour->size + child->size >= 2 * InternalNode::min_size) {
+            size_type count{ (neighbour->size - child->size) / 2 };
+            if (from_left) {
+                child->borrow_left(parent->values[childpos - 1], left, count);
+            } else {
+                child->borrow_right(parent->values[childpos], right, count);
+            }
+        } else if (from_left) {
+            left->merge(parent->values[childpos - 1], child);
+            free_node(child);
+            parent->erase_at(childpos - 1);
+        } else {
+            child->merge(parent->values[childpos], right);
+            free_node(right);
+            parent->erase_at(childpos);
+        }
+    }
+
+public:
+    ADS_packed_set() : ADS_packed_set(Allocator()) {}
+
+    explicit ADS_packed_set(const Allocator& alloc) : internal_pool{ alloc }, external_pool{ alloc }, root{ nullptr } {
+        root = new_external();
+    }
+
+    ADS_packed_set(std::initializer_list<key_type> ilist, const Allocator& alloc = Allocator())
+            : ADS_packed_set(ilist.begin(), ilist.end(), alloc) {}
+
+    template<typename InputIt>
+    ADS_packed_set(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+            : internal_pool{ alloc }, external_pool{ alloc }, root{ nullptr } {
+        std::vector<word> keys;
+        for (; first != last; ++first) {
+            keys.push_back(encode(*first));
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        root = build_tree(keys);
+        sz = keys.size();
+    }
+
+    // the leaves of the copy are packed as full as their keys allow
+    ADS_packed_set(const ADS_packed_set& other)
+            : internal_pool{ std::allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator()) },
+              external_pool{ internal_pool.get_allocator() },
+              root{ nullptr },
+              sz{ other.sz } {
+        root = build_tree(other.words());
+    }
+
+    ADS_packed_set(ADS_packed_set&& other) noexcept
+            : internal_pool{ std::move(other.internal_pool) },
+              external_pool{ std::move(other.external_pool) },
+              root{ other.root },
+              sz{ other.sz } {
+        other.root = empty_root();
+        other.sz = 0;
+    }
+
+    // nodes hold nothing but integers and links, the pools drop them as a whole
+    ~ADS_packed_set() = default;
+
+    ADS_packed_set& operator=(const ADS_packed_set& other) {
+        if (this != &other) {
+            ADS_packed_set copy{ other };
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ADS_packed_set& operator=(ADS_packed_set&& other) noexcept {
+        if (this != &other) {
+            ADS_packed_set moved{ std::move(other) };
+            swap(moved);
+        }
+        return *this;
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const {
+        return internal_pool.get_allocator();
+    }
+
+    [[nodiscard]] size_type size() const {
+        return sz;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return sz == 0;
+    }
+
+    std::pair<iterator, bool> insert(const key_type& key) {
+        TRACE_INF("Inserting element: " << key)
+        return insert_unique(encode(key));
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert_unique(encode(*first));
+        }
+    }
+
+    void insert(std::initializer_list<key_type> ilist) {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    // erasing never repacks: the base stays a lower bound of the remaining deltas
+    size_type erase(const key_type& key) {
+        TRACE_INF("Erasing element: " << key)
+        word encoded{ encode(key) };
+        PathEntry path[max_height];
+        size_type depth;
+        ExternalNode* leaf{ find_leaf(encoded, path, depth) };
+        size_type pos{ leaf->template rank<false>(encoded) };
+        if (pos == leaf->size || leaf->key_at(pos) != encoded) return 0;
+        leaf->erase_at(pos);
+        --sz;
+
+        if (depth > 0 && leaf->size < ExternalNode::min_size) {
+            rebalance_leaf(path, depth - 1);
+            for (--depth; depth > 0 && path[depth].node->size < InternalNode::min_size; --depth) {
+                rebalance_internal(path, depth - 1);
+            }
+        }
+        if (root->size == 0 && root->type == NodeType::INTERNAL) {
+            TRACE_DEB("Erase triggered root merge")
+            link old_root{ root };
+            root = static_cast<InternalNode*>(root)->children[0];
+            free_node(old_root);
+        }
+        return 1;
+    }
+
+    void clear() {
+        internal_pool.release();
+        external_pool.release();
+        root = new_external();
+        sz = 0;
+    }
+
+    size_type count(const key_type& key) const {
+        word encoded{ encode(key) };
+        ExternalNode* leaf{ find_leaf(encoded) };
+        size_type pos{ leaf->template rank<false>(encoded) };
+        return pos < leaf->size && leaf->key_at(pos) == encoded ? 1 : 0;
+    }
+
+    iterator find(const key_type& key) const {
+        word encoded{ encode(key) };
+        ExternalNode* leaf{ find_leaf(encoded) };
+        size_type pos{ leaf->template rank<false>(encoded) };
+        if (pos < leaf->size && leaf->key_at(pos) == encoded) return Iterator(leaf, pos);
+        return end();
+    }
+
+    // first key not less than key
+    iterator lower_bound(const key_type& key) const {
+        word encoded{ encode(key) };
+        ExternalNode* leaf{ find_leaf(encoded) };
+        return leaf_iterator(leaf, leaf->template rank<false>(encoded));
+    }
+
+    // first key greater than key
+    iterator upper_bound(const key_type& key) const {
+        word encoded{ encode(key) };
+        ExternalNode* leaf{ find_leaf(encoded) };
+        return leaf_iterator(leaf, leaf->template rank<true>(encoded));
+    }
+
+    // calls visitor with every key in [lo, hi) in ascending order and returns the number of visited keys, like
+    // ADS_set::for_each_in_range. every leaf is decoded in one loop over its deltas
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) const {
+        if (!cmp(lo, hi)) return 0;
+        word upper{ encode(hi) };
+        ExternalNode* leaf{ find_leaf(encode(lo)) };
+        size_type pos{ leaf->template rank<false>(encode(lo)) };
+        size_type visited{ 0 };
+        while (leaf) {
+            if (leaf->next) ads_detail::prefetch(leaf->next, sizeof(ExternalNode));
+            bool last{ leaf->size > 0 && leaf->key_at(leaf->size - 1) >= upper }; // range ends in this leaf
+            size_type stop{ last ? leaf->template rank<false>(upper) : leaf->size };
+            bool stopped{ leaf->visit([&](const auto* deltas) {
+                for (; pos < stop; ++pos) {
+                    const key_type key{ decode(static_cast<word>(leaf->base + deltas[pos])) };
+                    ++visited;
+                    if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                        if (!visitor(key)) return true;
+                    } else {
+                        visitor(key);
+                    }
+                }
+                return false;
+            }) };
+            if (stopped || last) break;
+            leaf = leaf->next;
+            pos = 0;
+        }
+        return visited;
+    }
+
+    const_iterator begin() const {
+        ExternalNode* leaf{ first_leaf() };
+        if (leaf->size == 0) return end();
+        return Iterator(leaf, 0);
+    }
+
+    const_iterator end() const {
+        return Iterator();
+    }
+
+    void swap(ADS_packed_set& other) {
+        internal_pool.swap(other.internal_pool);
+        external_pool.swap(other.external_pool);
+        std::swap(root, other.root);
+        std::swap(sz, other.sz);
+    }
+
+    bool operator==(const ADS_packed_set& rhs) const {
+        if (sz != rhs.sz) return false;
+        for (const_iterator itl{ begin() }, itr{ rhs.begin() }; itl != end(); ++itl, ++itr) {
+            if (*itl != *itr) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const ADS_packed_set& rhs) const {
+        return !operator==(rhs);
+    }
+};
+
+// keys are decoded on access, there is nothing to refer to: operator* returns by value (see the note on the
+// iterator of ADS_set)
+template<typename Key, typename Allocator>
+class ADS_packed_set<Key, Allocator>::Iterator {
+public:
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+    using pointer = void;
+    using iterator_category = std::input_iterator_tag;
+
+private:
+    ExternalNode* current;
+    size_type pos;
+
+public:
+    Iterator() : current{ nullptr }, pos{ 0 } {}
+
+    explicit Iterator(ExternalNode* _current, size_type _pos) : current{ _current }, pos{ _pos } {}
+
+    reference operator*() const {
+        return decode(current->key_at(pos));
+    }
+
+    Iterator& operator++() {
+        if (current) {
+            if (pos + 1 == current->size) {
+                current = current->next;
+                pos = 0;
+            } else {
+                ++pos;
+            }
+        }
+        return *this;
+    }
+
+    Iterator operator++(int) {
+        Iterator old{ *this };
+        this->operator++();
+        return old;
+    }
+
+    bool operator==(const Iterator& rhs) const {
+        return current == rhs.current && pos == rhs.pos;
+    }
+
+    bool operator!=(const Iterator& rhs) const {
+        return current != rhs.current || pos != rhs.pos;
+    }
+};
+
+template<typename Key, typename Allocator>
+struct alignas(ads_detail::cache_line_size) ADS_packed_set<Key, Allocator>::Node {
+    NodeType type;
+    size_type size;
+
+    Node(NodeType _type, size_type _size) : type{ _type }, size{ _size } {}
+};
+
+template<typename Key, typename Allocator>
+struct ADS_packed_set<Key, Allocator>::InternalNode : public Node {
+    static constexpr size_type M{ internal_capacity };
+    static constexpr size_type min_size{ M / 2 };
+    word values[M + 1]; // temporary invalid nodes require + 1
+    link children[M + 2];
+
+    InternalNode() : Node(NodeType::INTERNAL, 0) {}
+
+    size_type find_child_pos(word key) const {
+        return ads_detail::sorted_rank<true>(values, this->size, key); // keys equal to a separator live right of it
+    }
+
+    // inserts key at ins, the child right of it has to be set by the caller
+    void insert_at(word key, size_type ins) {
+        std::copy_backward(values + ins, values + this->size, values + this->size + 1);
+        std::copy_backward(children + ins + 1, children + this->size + 1, children + this->size + 2);
+        values[ins] = key;
+        ++this->size;
+    }
+
+    // erases the key at and the child right of at, the child has to be freed by the caller
+    void erase_at(size_type at) {
+        std::copy(values + at + 1, values + this->size, values + at);
+        std::copy(children + at + 2, children + this->size + 1, children + at + 1);
+        --this->size;
+    }
+
+    // moves everything after split_at to the empty node right, returns the index key for the parent
+    word split(size_type split_at, InternalNode* right) {
+        right->size = this->size - split_at - 1;
+        std::copy(values + split_at + 1, values + this->size, right->values);
+        std::copy(children + split_at + 1, children + this->size + 1, right->children);
+        this->size = split_at;
+        return values[split_at];
+    }
+
+    // rotates the last count children of left (the left neighbour) through separator into the front of this node
+    void borrow_left(word& separator, InternalNode* left, size_type count) {
+        std::copy_backward(values, values + this->size, values + this->size + count);
+        std::copy_backward(children, children + this->size + 1, children + this->size + 1 + count);
+        values[count - 1] = separator;
+        std::copy(left->values + left->size - count + 1, left->values + left->size, values);
+        std::copy(left->children + left->size - count + 1, left->children + left->size + 1, children);
+        separator = left->values[left->size - count];
+        left->size -= count;
+        this->size += count;
+    }
+
+    // rotates the first count children of right (the right neighbour) through separator onto the end of this node
+    void borrow_right(word& separator, InternalNode* right, size_type count) {
+        values[this->size] = separator;
+        std::copy(right->values, right->values + count - 1, values + this->size + 1);
+        std::copy(right->children, right->children + count, children + this->size + 1);
+        separator = right->values[count - 1];
+        std::copy(right->values + count, right->values + right->size, right->values);
+        std::copy(right->children + count, right->children + right->size + 1, right->children);
+        right->size -= count;
+        this->size += count;
+    }
+
+    void merge(word pulled_down, InternalNode* neighbour) {
+        values[this->size++] = pulled_down;
+        std::copy(neighbour->values, neighbour->values + neighbour->size, values + this->size);
+        std::copy(neighbour->children, neighbour->children + neighbour->size + 1, children + this->size);
+        this->size += neighbour->size;
+    }
+};
+
+// base plus size deltas of width bytes each. deltas are unsigned, so base is a lower bound of the keys but
+// not necessarily one of them (it stays in place when the first key is erased)
+template<typename Key, typename Allocator>
+struct ADS_packed_set<Key, Allocator>::ExternalNode : public Node {
+    static constexpr size_type min_size{ delta_bytes / sizeof(word) / 2 }; // half of a leaf that can not compress at all
+    ExternalNode* next;
+    word base{ 0 };
+    unsigned char width{ 1 };
+    alignas(uint64_t) unsigned char deltas[delta_bytes];
+
+    explicit ExternalNode(ExternalNode* _next = nullptr) : Node(NodeType::EXTERNAL, 0), next{ _next } {}
+
+    // smallest width whose deltas hold span
+    static unsigned char width_for(word span) {
+        unsigned char bytes{ 1 };
+        while (bytes < sizeof(word) && (span >> (8 * bytes)) != 0) bytes *= 2;
+        return bytes;
+    }
+
+    static size_type capacity(unsigned char bytes) {
+        return delta_bytes / bytes;
+    }
+
+    // whether the sorted keys [keys, keys + count) fit into one leaf
+    static bool fits(const word* keys, size_type count) {
+        return count == 0 || count <= capacity(width_for(static_cast<word>(keys[count - 1] - keys[0])));
+    }
+
+    // calls f with the deltas as an array of the unsigned type of their width
+    template<typename F>
+    decltype(auto) visit(F&& f) const {
+        switch (width) {
+            case 1: return f(reinterpret_cast<const uint8_t*>(deltas));
+            case 2: return f(reinterpret_cast<const uint16_t*>(deltas));
+            case 4: return f(reinterpret_cast<const uint32_t*>(deltas));
+            default: return f(reinterpret_cast<const uint64_t*>(deltas));
+        }
+    }
+
+    template<typename F>
+    decltype(auto) visit(F&& f) {
+        switch (width) {
+            case 1: return f(reinterpret_cast<uint8_t*>(deltas));
+            case 2: return f(reinterpret_cast<uint16_t*>(deltas));
+            case 4: return f(reinterpret_cast<uint32_t*>(deltas));
+            default: return f(reinterpret_cast<uint64_t*>(deltas));
+        }
+    }
+
+    word key_at(size_type pos) const {
+        return visit([&](const auto* d) { return static_cast<word>(base + d[pos]); });
+    }
+
+    // number of keys less than key, or not greater than key if upper. the needle is moved into the delta
+    // domain, needles beyond the range of the width are greater than every delta
+    template<bool upper>
+    size_type rank(word key) const {
+        if (this->size == 0 || key < base) return 0;
+        word delta{ static_cast<word>(key - base) };
+        return visit([&](const auto* d) -> size_type {
+            using Delta = std::remove_const_t<std::remove_pointer_t<decltype(d)>>;
+            if constexpr(sizeof(Delta) < sizeof(word)) {
+                if (delta > std::numeric_limits<Delta>::max()) return this->size;
+            }
+            return ads_detail::sorted_rank<upper>(d, this->size, static_cast<Delta>(delta));
+        });
+    }
+
+    void unpack(word* out) const {
+        visit([&](const auto* d) {
+            for (size_type i{ 0 }; i < this->size; ++i) {
+                out[i] = static_cast<word>(base + d[i]);
+            }
+        });
+    }
+
+    // replaces the contents with the sorted keys [keys, keys + count), which have to fit
+    void pack(const word* keys, size_type count) {
+        base = count > 0 ? keys[0] : 0;
+        width = count > 0 ? width_for(static_cast<word>(keys[count - 1] - keys[0])) : 1;
+        visit([&](auto* d) {
+            using Delta = std::remove_pointer_t<decltype(d)>;
+            for (size_type i{ 0 }; i < count; ++i) {
+                d[i] = static_cast<Delta>(keys[i] - base);
+            }
+        });
+        this->size = count;
+    }
+
+    // inserts key at pos in place, false if the leaf is full or key does not fit its base and width
+    bool insert_at(word key, size_type pos) {
+        if (this->size == capacity(width) || key < base) return false;
+        word delta{ static_cast<word>(key - base) };
+        return visit([&](auto* d) {
+            using Delta = std::remove_pointer_t<decltype(d)>;
+            if constexpr(sizeof(Delta) < sizeof(word)) {
+                if (delta > std::numeric_limits<Delta>::max()) return false;
+            }
+            std::memmove(d + pos + 1, d + pos, (this->size - pos) * sizeof(Delta));
+            d[pos] = static_cast<Delta>(delta);
+            ++this->size;
+            return true;
+        });
+    }
+
+    void erase_at(size_type pos) {
+        visit([&](auto* d) {
+            std::memmove(d + pos, d + pos + 1, (this->size - pos - 1) * sizeof(*d));
+        });
+        --this->size;
+    }
+};
+
+template<typename Key, typename Allocator>
+void swap(ADS_packed_set<Key, Allocator>& lhs, ADS_packed_set<Key, Allocator>& rhs) {
+    lhs.swap(rhs);
+}
+
+#endif
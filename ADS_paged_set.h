@@ -0,0 +1,612 @@
+#ifndef ADS_PAGED_SET_H
+#define ADS_PAGED_SET_H
+
+#include "ADS_set.h"
+
+#include<cerrno>
+#include<cstdlib>
+#include<system_error>
+#include<unordered_map>
+
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+namespace ads_detail {
+    struct BufferPoolStats {
+        uint64_t hits{ 0 };
+        uint64_t misses{ 0 }; // pages read from the file
+        uint64_t evictions{ 0 };
+        uint64_t write_backs{ 0 }; // dirty pages written to the file
+    };
+
+    // a fixed number of page frames caching the pages of one file. pages are pinned while in use and only unpinned
+    // frames are evicted, picked by the CLOCK algorithm (every use sets a reference bit, which the hand clears
+    // once before it evicts). dirty pages are written back when they are evicted and by flush()
+    class BufferPool {
+        struct Frame {
+            uint64_t page{ 0 };
+            unsigned pins{ 0 };
+            bool used{ false };
+            bool dirty{ false };
+            bool referenced{ false };
+        };
+
+        int fd;
+        unsigned char* memory; // frames * page_size bytes, page aligned
+        std::vector<Frame> frames;
+        std::unordered_map<uint64_t, size_t> table; // page -> frame
+        size_t hand{ 0 };
+        BufferPoolStats counters;
+
+        unsigned char* data(size_t frame) const {
+            return memory + frame * page_size;
+        }
+
+        void write_back(size_t frame) {
+            ssize_t written{ pwrite(fd, data(frame), page_size, static_cast<off_t>(frames[frame].page * page_size)) };
+            if (written != static_cast<ssize_t>(page_size)) throw std::system_error(errno, std::generic_category(), "cannot write page");
+            frames[frame].dirty = false;
+            ++counters.write_backs;
+        }
+
+        // a frame that can be (re)used, throws if all of them are pinned
+        size_t victim() {
+            for (size_t step{ 0 }; step < 2 * frames.size(); ++step, hand = (hand + 1) % frames.size()) {
+                Frame& frame{ frames[hand] };
+                if (!frame.used) return hand;
+                if (frame.pins > 0) continue;
+                if (frame.referenced) {
+                    frame.referenced = false;
+                    continue;
+                }
+                if (frame.dirty) write_back(hand);
+                table.erase(frame.page);
+                frame.used = false;
+                ++counters.evictions;
+                return hand;
+            }
+            throw std::runtime_error("all buffer pool frames are pinned");
+        }
+
+        unsigned char* install(uint64_t page, bool read) {
+            size_t frame{ victim() };
+            hand = (hand + 1) % frames.size();
+            if (read) {
+                ssize_t got{ pread(fd, data(frame), page_size, static_cast<off_t>(page * page_size)) };
+                if (got < 0) throw std::system_error(errno, std::generic_category(), "cannot read page");
+                std::memset(data(frame) + got, 0, page_size - static_cast<size_t>(got)); // beyond the end of the file
+                ++counters.misses;
+            } else {
+                std::memset(data(frame), 0, page_size);
+            }
+            frames[frame] = Frame{ page, 1, true, !read, true };
+            table.emplace(page, frame);
+            return data(frame);
+        }
+
+    public:
+        // opens (or creates) the file at path, throws std::system_error if that fails
+        BufferPool(const std::string& path, size_t frame_count) : frames(std::max<size_t>(frame_count, 1)) {
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0) throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+            memory = static_cast<unsigned char*>(std::aligned_alloc(page_size, frames.size() * page_size));
+            if (!memory) {
+                ::close(fd);
+                throw std::bad_alloc();
+            }
+            table.reserve(frames.size());
+        }
+
+        BufferPool(const BufferPool&) = delete;
+
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        // dirty pages are lost unless flush() was called
+        ~BufferPool() {
+            std::free(memory);
+            ::close(fd);
+        }
+
+        // the contents of page, which stay in memory until the matching unpin
+        unsigned char* pin(uint64_t page) {
+            auto found{ table.find(page) };
+            if (found == table.end()) return install(page, true);
+            Frame& frame{ frames[found->second] };
+            ++frame.pins;
+            frame.referenced = true;
+            ++counters.hits;
+            return data(found->second);
+        }
+
+        // pins a page whose old contents do not matter, it is zero filled instead of read
+        unsigned char* pin_new(uint64_t page) {
+            auto found{ table.find(page) };
+            if (found == table.end()) return install(page, false);
+            Frame& frame{ frames[found->second] };
+            ++frame.pins;
+            frame.referenced = true;
+            frame.dirty = true;
+            std::memset(data(found->second), 0, page_size);
+            return data(found->second);
+        }
+
+        void unpin(uint64_t page, bool dirty) {
+            Frame& frame{ frames[table.find(page)->second] };
+            --frame.pins;
+            frame.dirty = frame.dirty || dirty;
+        }
+
+        // writes all dirty pages back to the file
+        void flush() {
+            for (size_t frame{ 0 }; frame < frames.size(); ++frame) {
+                if (frames[frame].used && frames[frame].dirty) write_back(frame);
+            }
+            if (fsync(fd) != 0) throw std::system_error(errno, std::generic_category(), "cannot sync");
+        }
+
+        [[nodiscard]] uint64_t file_pages() const {
+            struct stat info;
+            if (fstat(fd, &info) != 0) throw std::system_error(errno, std::generic_category(), "cannot stat");
+            return static_cast<uint64_t>(info.st_size) / page_size;
+        }
+
+        [[nodiscard]] size_t capacity() const {
+            return frames.size();
+        }
+
+        [[nodiscard]] BufferPoolStats stats() const {
+            return counters;
+        }
+    };
+
+    // pins a page for its lifetime, writers mark it dirty
+    class PageGuard {
+        BufferPool* pool;
+        uint64_t number;
+        unsigned char* bytes;
+        bool dirty{ false };
+
+    public:
+        PageGuard(BufferPool& _pool, uint64_t _number, bool fresh = false)
+                : pool{ &_pool }, number{ _number }, bytes{ fresh ? _pool.pin_new(_number) : _pool.pin(_number) }, dirty{ fresh } {}
+
+        PageGuard(const PageGuard&) = delete;
+
+        PageGuard& operator=(const PageGuard&) = delete;
+
+        PageGuard(PageGuard&& other) noexcept : pool{ other.pool }, number{ other.number }, bytes{ other.bytes }, dirty{ other.dirty } {
+            other.pool = nullptr;
+        }
+
+        PageGuard& operator=(PageGuard&& other) noexcept {
+            if (this != &other) {
+                if (pool) pool->unpin(number, dirty);
+                pool = other.pool;
+                number = other.number;
+                bytes = other.bytes;
+                dirty = other.dirty;
+                other.pool = nullptr;
+            }
+            return *this;
+        }
+
+        ~PageGuard() {
+            if (pool) pool->unpin(number, dirty);
+        }
+
+        [[nodiscard]] uint64_t page() const {
+            return number;
+        }
+
+        [[nodiscard]] const unsigned char* data() const {
+            return bytes;
+        }
+
+        // the page is going to be written
+        unsigned char* write() {
+            dirty = true;
+            return bytes;
+        }
+    };
+}
+
+// ADS_set for key sets larger than memory: the nodes are the pages of a file in the format of ADS_set::save
+// (see ads_detail::PageLayout), identified by page number and accessed through a buffer pool of a fixed number
+// of frames. at most four pages are pinned at a time, so the pool can be far smaller than the file.
+// a file written by ADS_set::save can be opened and modified, a flushed file can be opened by mapped_ADS_set.
+// keys have to be trivially copyable, nothing is thread-safe
+template<typename Key>
+class ADS_paged_set {
+public:
+    using value_type = Key;
+    using key_type = Key;
+    using size_type = size_t;
+    using key_compare = std::less<key_type>;
+    using Stats = ads_detail::BufferPoolStats;
+
+    static constexpr size_type default_frames{ 1024 }; // 4 MiB
+
+private:
+    using Layout = ads_detail::PageLayout<key_type>;
+    using PageType = ads_detail::PageType;
+    using PageGuard = ads_detail::PageGuard;
+    static constexpr std::less<key_type> cmp = key_compare{};
+    static constexpr size_type leaf_min{ Layout::leaf_capacity / 2 };
+    static constexpr size_type internal_min{ Layout::internal_capacity / 2 };
+    static constexpr size_type max_height{ std::numeric_limits<size_type>::digits };
+    static_assert(std::is_trivially_copyable_v<key_type>, "only trivially copyable keys can be paged");
+
+    struct PathEntry {
+        uint64_t page;
+        size_type childpos;
+    };
+
+    ads_detail::BufferPool pool;
+    ads_detail::FileHeader header{}; // kept in memory, written by flush
+    // an internal node that overflows is split through these, they hold its keys and children plus the new ones
+    std::vector<key_type> overflow_keys;
+    std::vector<uint64_t> overflow_children;
+
+    static size_type count_of(const unsigned char* page) {
+        return Layout::header(page)->count;
+    }
+
+    static bool internal(const unsigned char* page) {
+        return Layout::header(page)->type == PageType::INTERNAL;
+    }
+
+    // a zeroed page of the given type, reused from the free list if possible
+    PageGuard allocate(PageType type) {
+        uint64_t number{ header.free_list };
+        if (number) {
+            PageGuard reused{ pool, number };
+            header.free_list = Layout::header(reused.data())->next;
+        } else {
+            number = header.pages++;
+        }
+        PageGuard page{ pool, number, true };
+        Layout::header(page.write())->type = type;
+        return page;
+    }
+
+    void release(PageGuard& page) {
+        unsigned char* bytes{ page.write() };
+        std::memset(bytes, 0, ads_detail::page_size);
+        Layout::header(bytes)->next = header.free_list;
+        header.free_list = page.page();
+    }
+
+    // descends to the leaf responsible for key, recording the internal pages on the way in path. only the
+    // current page is pinned
+    PageGuard find_leaf(const key_type& key, PathEntry* path, size_type& depth) {
+        depth = 0;
+        PageGuard page{ pool, header.root };
+        while (internal(page.data())) {
+            size_type childpos{ Layout::template rank<true>(page.data(), key) }; // keys equal to a separator live right of it
+            path[depth++] = PathEntry{ page.page(), childpos };
+            page = PageGuard{ pool, Layout::child_pages(page.data())[childpos] };
+        }
+        return page;
+    }
+
+    // moves the upper half of the full leaf into a new right neighbour and inserts key at pos into the half it
+    // belongs to. returns the new page and its first key
+    std::pair<uint64_t, key_type> split_leaf(PageGuard& leaf, const key_type& key, size_type pos) {
+        PageGuard right{ allocate(PageType::EXTERNAL) };
+        unsigned char* left_bytes{ leaf.write() };
+        unsigned char* right_bytes{ right.write() };
+        constexpr size_type mid{ Layout::leaf_capacity / 2 };
+        key_type* left_keys{ Layout::keys(left_bytes) };
+        key_type* right_keys{ Layout::keys(right_bytes) };
+        std::copy(left_keys + mid, left_keys + Layout::leaf_capacity, right_keys);
+        Layout::header(left_bytes)->count = mid;
+        Layout::header(right_bytes)->count = Layout::leaf_capacity - mid;
+        Layout::header(right_bytes)->next = Layout::header(left_bytes)->next;
+        Layout::header(left_bytes)->next = right.page();
+        if (pos <= mid) {
+            insert_key(left_bytes, key, pos);
+        } else {
+            insert_key(right_bytes, key, pos - mid);
+        }
+        return { right.page(), right_keys[0] };
+    }
+
+    static void insert_key(unsigned char* leaf, const key_type& key, size_type pos) {
+        key_type* keys{ Layout::keys(leaf) };
+        size_type count{ count_of(leaf) };
+        std::copy_backward(keys + pos, keys + count, keys + count + 1);
+        keys[pos] = key;
+        ++Layout::header(leaf)->count;
+    }
+
+    // links child with its index key right of position childpos of the internal page. a full page is split,
+    // the new right neighbour and the key moving up are returned (page 0 if there was no split)
+    std::pair<uint64_t, key_type> insert_child(PageGuard& node, size_type childpos, const key_type& key, uint64_t child) {
+        unsigned char* bytes{ node.write() };
+        key_type* keys{ Layout::keys(bytes) };
+        uint64_t* children{ Layout::child_pages(bytes) };
+        size_type count{ count_of(bytes) };
+        if (count < Layout::internal_capacity) {
+            std::copy_backward(keys + childpos, keys + count, keys + count + 1);
+            std::copy_backward(children + childpos + 1, children + count + 1, children + count + 2);
+            keys[childpos] = key;
+            children[childpos + 1] = child;
+            ++Layout::header(bytes)->count;
+            return { 0, key };
+        }
+
+        overflow_keys.assign(keys, keys + count);
+        overflow_children.assign(children, children + count + 1);
+        overflow_keys.insert(overflow_keys.begin() + childpos, key);
+        overflow_children.insert(overflow_children.begin() + childpos + 1, child);
+        size_type mid{ overflow_keys.size() / 2 }; // moves up, the keys left and right of it stay
+        PageGuard right{ allocate(PageType::INTERNAL) };
+        unsigned char* right_bytes{ right.write() };
+        std::copy(overflow_keys.begin(), overflow_keys.begin() + mid, keys);
+        std::copy(overflow_children.begin(), overflow_children.begin() + mid + 1, children);
+        Layout::header(bytes)->count = mid;
+        std::copy(overflow_keys.begin() + mid + 1, overflow_keys.end(), Layout::keys(right_bytes));
+        std::copy(overflow_children.begin() + mid + 1, overflow_children.end(), Layout::child_pages(right_bytes));
+        Layout::header(right_bytes)->count = overflow_keys.size() - mid - 1;
+        return { right.page(), overflow_keys[mid] };
+    }
+
+    // restores the minimum size of the child path[level] leads to, like ADS_set::rebalance: the larger neighbour
+    // hands over keys if it has enough to spare, otherwise the two are merged and the right one is freed
+    void rebalance(const PathEntry* path, size_type level) {
+        PageGuard parent{ pool, path[level].page };
+        unsigned char* parent_bytes{ parent.write() };
+        key_type* separators{ Layout::keys(parent_bytes) };
+        uint64_t* siblings{ Layout::child_pages(parent_bytes) };
+        size_type childpos{ path[level].childpos };
+        size_type parent_count{ count_of(parent_bytes) };
+        PageGuard child{ pool, siblings[childpos] };
+        bool from_left{ childpos > 0 };
+        if (from_left && childpos < parent_count) { // both neighbours exist, take the larger one
+            PageGuard left{ pool, siblings[childpos - 1] };
+            PageGuard right{ pool, siblings[childpos + 1] };
+            from_left = count_of(left.data()) >= count_of(right.data());
+        }
+        PageGuard neighbour{ pool, siblings[from_left ? childpos - 1 : childpos + 1] };
+        PageGuard& left{ from_left ? neighbour : child };
+        PageGuard& right{ from_left ? child : neighbour };
+        key_type& separator{ separators[from_left ? childpos - 1 : childpos] };
+        unsigned char* left_bytes{ left.write() };
+        unsigned char* right_bytes{ right.write() };
+        key_type* left_keys{ Layout::keys(left_bytes) };
+        key_type* right_keys{ Layout::keys(right_bytes) };
+        size_type left_count{ count_of(left_bytes) };
+        size_type right_count{ count_of(right_bytes) };
+        bool leaves{ !internal(left_bytes) };
+        size_type min_size{ leaves ? leaf_min : internal_min };
+
+        if (left_count + right_count >= 2 * min_size) { // both end up with at least min_size keys
+            size_type count{ (std::max(left_count, right_count) - std::min(left_count, right_count)) / 2 };
+            if (leaves && from_left) { // last keys of left to the front of right
+                std::copy_backward(right_keys, right_keys + right_count, right_keys + right_count + count);
+                std::copy(left_keys + left_count - count, left_keys + left_count, right_keys);
+                separator = right_keys[0];
+            } else if (leaves) { // first keys of right to the back of left
+                std::copy(right_keys, right_keys + count, left_keys + left_count);
+                std::copy(right_keys + count, right_keys + right_count, right_keys);
+                separator = right_keys[0];
+            } else if (from_left) { // rotated through the separator
+                uint64_t* left_children{ Layout::child_pages(left_bytes) };
+                uint64_t* right_children{ Layout::child_pages(right_bytes) };
+                std::copy_backward(right_keys, right_keys + right_count, right_keys + right_count + count);
+                std::copy_backward(right_children, right_children + right_count + 1, right_children + right_count + 1 + count);
+                right_keys[count - 1] = separator;
+                std::copy(left_keys + left_count - count + 1, left_keys + left_count, right_keys);
+                std::copy(left_children + left_count - count + 1, left_children + left_count + 1, right_children);
+                separator = left_keys[left_count - count];
+            } else {
+                uint64_t* left_children{ Layout::child_pages(left_bytes) };
+                uint64_t* right_children{ Layout::child_pages(right_bytes) };
+                left_keys[left_count] = separator;
+                std::copy(right_keys, right_keys + count - 1, left_keys + left_count + 1);
+                std::copy(right_children, right_children + count, left_children + left_count + 1);
+                separator = right_keys[count - 1];
+                std::copy(right_keys + count, right_keys + right_count, right_keys);
+                std::copy(right_children + count, right_children + right_count + 1, right_children);
+            }
+            Layout::header(left_bytes)->count = from_left ? left_count - count : left_count + count;
+            Layout::header(right_bytes)->count = from_left ? right_count + count : right_count - count;
+            return;
+        }
+
+        // fits into the left page, including a pulled-down separator
+        if (leaves) {
+            std::copy(right_keys, right_keys + right_count, left_keys + left_count);
+            Layout::header(left_bytes)->count = left_count + right_count;
+            Layout::header(left_bytes)->next = Layout::header(right_bytes)->next;
+        } else {
+            left_keys[left_count] = separator;
+            std::copy(right_keys, right_keys + right_count, left_keys + left_count + 1);
+            std::copy(Layout::child_pages(right_bytes), Layout::child_pages(right_bytes) + right_count + 1, Layout::child_pages(left_bytes) + left_count + 1);
+            Layout::header(left_bytes)->count = left_count + right_count + 1;
+        }
+        size_type erased{ from_left ? childpos - 1 : childpos }; // separator of the merged pair
+        std::copy(separators + erased + 1, separators + parent_count, separators + erased);
+        std::copy(siblings + erased + 2, siblings + parent_count + 1, siblings + erased + 1);
+        Layout::header(parent_bytes)->count = parent_count - 1;
+        release(right);
+    }
+
+public:
+    // opens the set stored in the file at path, which is created empty if it does not exist or is empty.
+    // frames is the number of pages the buffer pool keeps in memory (at least 8). throws std::system_error if the
+    // file can not be opened and std::runtime_error if it is no ADS_set file for this key type
+    explicit ADS_paged_set(const std::string& path, size_type frames = default_frames) : pool{ path, std::max<size_type>(frames, 8) } {
+        if (pool.file_pages() == 0) {
+            std::memcpy(header.magic, ads_detail::file_magic, sizeof(header.magic));
+            header.version = ads_detail::file_version;
+            header.page_size = ads_detail::page_size;
+            header.key_size = sizeof(key_type);
+            header.key_align = alignof(key_type);
+            header.byte_order = ads_detail::file_byte_order;
+            header.pages = 1;
+            PageGuard root{ allocate(PageType::EXTERNAL) };
+            header.root = root.page();
+            header.height = 1;
+            return;
+        }
+        uint64_t pages{ pool.file_pages() };
+        {
+            PageGuard first{ pool, 0 };
+            std::memcpy(&header, first.data(), sizeof(header));
+        }
+        if (std::memcmp(header.magic, ads_detail::file_magic, sizeof(header.magic)) != 0 || header.version != ads_detail::file_version
+            || header.page_size != ads_detail::page_size || header.byte_order != ads_detail::file_byte_order
+            || header.key_size != sizeof(key_type) || header.key_align != alignof(key_type)
+            || header.pages > pages || header.root == 0 || header.root >= header.pages) {
+            throw std::runtime_error(path + " is not an ADS_set file for this key type");
+        }
+    }
+
+    ADS_paged_set(const ADS_paged_set&) = delete;
+
+    ADS_paged_set& operator=(const ADS_paged_set&) = delete;
+
+    // flushes, errors are only reported by an explicit flush()
+    ~ADS_paged_set() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    // writes the header and all dirty pages back to the file
+    void flush() {
+        {
+            PageGuard first{ pool, 0 };
+            std::memcpy(first.write(), &header, sizeof(header));
+        }
+        pool.flush();
+    }
+
+    [[nodiscard]] size_type size() const {
+        return static_cast<size_type>(header.size);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return header.size == 0;
+    }
+
+    // pages of the file, including the header page and unused ones
+    [[nodiscard]] size_type pages() const {
+        return static_cast<size_type>(header.pages);
+    }
+
+    // hit and miss counters of the buffer pool
+    [[nodiscard]] Stats stats() const {
+        return pool.stats();
+    }
+
+    size_type count(const key_type& key) {
+        PathEntry path[max_height];
+        size_type depth;
+        PageGuard leaf{ find_leaf(key, path, depth) };
+        size_type pos{ Layout::template rank<false>(leaf.data(), key) };
+        return pos < count_of(leaf.data()) && !cmp(key, Layout::keys(leaf.data())[pos]) ? 1 : 0;
+    }
+
+    bool insert(const key_type& key) {
+        TRACE_INF("Inserting element: " << key)
+        PathEntry path[max_height];
+        size_type depth;
+        PageGuard leaf{ find_leaf(key, path, depth) };
+        size_type pos{ Layout::template rank<false>(leaf.data(), key) };
+        if (pos < count_of(leaf.data()) && !cmp(key, Layout::keys(leaf.data())[pos])) return false;
+        ++header.size;
+        if (count_of(leaf.data()) < Layout::leaf_capacity) {
+            insert_key(leaf.write(), key, pos);
+            return true;
+        }
+
+        // split upwards as long as the pages on the path are full
+        std::pair<uint64_t, key_type> splitres{ split_leaf(leaf, key, pos) };
+        uint64_t child{ leaf.page() };
+        while (depth > 0) {
+            PageGuard parent{ pool, path[--depth].page };
+            splitres = insert_child(parent, path[depth].childpos, splitres.second, splitres.first);
+            if (splitres.first == 0) return true;
+            child = parent.page();
+        }
+        TRACE_DEB("Insert triggered root split")
+        PageGuard root{ allocate(PageType::INTERNAL) };
+        unsigned char* bytes{ root.write() };
+        Layout::keys(bytes)[0] = splitres.second;
+        Layout::child_pages(bytes)[0] = child;
+        Layout::child_pages(bytes)[1] = splitres.first;
+        Layout::header(bytes)->count = 1;
+        header.root = root.page();
+        ++header.height;
+        return true;
+    }
+
+    size_type erase(const key_type& key) {
+        TRACE_INF("Erasing element: " << key)
+        PathEntry path[max_height];
+        size_type depth;
+        {
+            PageGuard leaf{ find_leaf(key, path, depth) };
+            size_type pos{ Layout::template rank<false>(leaf.data(), key) };
+            size_type count{ count_of(leaf.data()) };
+            if (pos == count || cmp(key, Layout::keys(leaf.data())[pos])) return 0;
+            key_type* keys{ Layout::keys(leaf.write()) };
+            std::copy(keys + pos + 1, keys + count, keys + pos);
+            Layout::header(leaf.write())->count = count - 1;
+            --header.size;
+            if (depth == 0 || count - 1 >= leaf_min) return 1;
+        }
+
+        // merge upwards as long as the pages on the path are underfull
+        rebalance(path, depth - 1);
+        for (--depth; depth > 0; --depth) {
+            PageGuard node{ pool, path[depth].page };
+            if (count_of(node.data()) >= internal_min) break;
+            rebalance(path, depth - 1);
+        }
+        PageGuard root{ pool, header.root };
+        if (internal(root.data()) && count_of(root.data()) == 0) {
+            TRACE_DEB("Erase triggered root merge")
+            header.root = Layout::child_pages(root.data())[0];
+            --header.height;
+            release(root);
+        }
+        return 1;
+    }
+
+    // calls visitor for every key in [lo, hi) in ascending order and returns the number of visited keys, like
+    // ADS_set::for_each_in_range. a visitor returning bool stops the scan by returning false
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) {
+        if (!cmp(lo, hi)) return 0;
+        PathEntry path[max_height];
+        size_type depth;
+        PageGuard leaf{ find_leaf(lo, path, depth) };
+        size_type pos{ Layout::template rank<false>(leaf.data(), lo) };
+        size_type visited{ 0 };
+        while (true) {
+            const key_type* keys{ Layout::keys(leaf.data()) };
+            size_type count{ count_of(leaf.data()) };
+            bool last{ count > 0 && !cmp(keys[count - 1], hi) }; // range ends in this leaf
+            size_type stop{ last ? Layout::template rank<false>(leaf.data(), hi) : count };
+            for (; pos < stop; ++pos, ++visited) {
+                if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                    if (!visitor(keys[pos])) return visited + 1;
+                } else {
+                    visitor(keys[pos]);
+                }
+            }
+            uint64_t next{ Layout::header(leaf.data())->next };
+            if (last || !next) break;
+            leaf = PageGuard{ pool, next };
+            pos = 0;
+        }
+        return visited;
+    }
+};
+
+#endif
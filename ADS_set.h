@@ -27,17 +27,786 @@
 #define TRACE_ERR_IF(cond, msg)
 #endif
 
+// operation counters of ADS_set (see ads_detail::OpCounters), compiled in with -DADS_SET_STATS
+#ifdef ADS_SET_STATS
+#define ADS_SET_COUNT(counter, n) counters.counter.fetch_add(n, std::memory_order_relaxed);
+#else
+#define ADS_SET_COUNT(counter, n)
+#endif
+
 #include<algorithm>
+#include<array>
+#include<atomic>
+#include<cstdint>
+#include<cstring>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<limits>
+#include<memory>
+#include<stdexcept>
+#include<string>
+#include<thread>
+#include<type_traits>
+#include<typeinfo>
+#include<vector>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include<immintrin.h>
+#endif
 
 inline int invert(int n) {
     return -(n + 1);
 }
 
-// v2, now with 100% less memory leaks!
-template<typename Key, size_t N = 2>
+// search kernels for sorted arrays of arithmetic keys, used by Node::findpos and InternalNode::find_child_pos
+namespace ads_detail {
+    inline constexpr size_t cache_line_size{ 64 };
+
+    // hints the cache lines of [ptr, ptr + bytes) into the cache, no-op where the builtin is unavailable
+    inline void prefetch(const void* ptr, size_t bytes) {
+#if defined(__GNUC__)
+        const char* line{ static_cast<const char*>(ptr) };
+        for (size_t offset{ 0 }; offset < bytes; offset += cache_line_size) {
+            __builtin_prefetch(line + offset);
+        }
+#else
+        (void) ptr;
+        (void) bytes;
+#endif
+    }
+
+    inline size_t popcount(unsigned mask) {
+#if defined(__GNUC__)
+        return static_cast<size_t>(__builtin_popcount(mask));
+#else
+        size_t count{ 0 };
+        for (; mask; mask &= mask - 1) ++count;
+        return count;
+#endif
+    }
+
+    // number of keys in [keys, keys + size) that are greater than elem (or less than elem, if !greater).
+    // compilers turn this into cmov/setcc (or vectorize it), no branch depends on the key values
+    template<bool greater, typename T>
+    inline size_t count_scalar(const T* keys, size_t size, T elem) {
+        size_t count{ 0 };
+        for (size_t i{ 0 }; i < size; ++i) {
+            count += greater ? elem < keys[i] : keys[i] < elem;
+        }
+        return count;
+    }
+
+    // same as count_scalar, but compares whole vector registers at once where the key type allows it.
+    // unsigned integers are biased into the signed range, as there are no unsigned compares before AVX-512
+    template<bool greater, typename T>
+    inline size_t count_compare(const T* keys, size_t size, T elem) {
+        size_t i{ 0 };
+        size_t count{ 0 };
+#if defined(__AVX2__)
+        if constexpr(std::is_integral_v<T> && sizeof(T) == 1) {
+            const __m256i bias{ _mm256_set1_epi8(std::is_signed_v<T> ? 0 : INT8_MIN) };
+            const __m256i needle{ _mm256_xor_si256(_mm256_set1_epi8(static_cast<char>(elem)), bias) };
+            for (; i + 32 <= size; i += 32) {
+                __m256i block{ _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias) };
+                __m256i mask{ greater ? _mm256_cmpgt_epi8(block, needle) : _mm256_cmpgt_epi8(needle, block) };
+                count += popcount(static_cast<unsigned>(_mm256_movemask_epi8(mask)));
+            }
+        } else if constexpr(std::is_integral_v<T> && sizeof(T) == 2) {
+            const __m256i bias{ _mm256_set1_epi16(std::is_signed_v<T> ? 0 : INT16_MIN) };
+            const __m256i needle{ _mm256_xor_si256(_mm256_set1_epi16(static_cast<short>(elem)), bias) };
+            for (; i + 16 <= size; i += 16) {
+                __m256i block{ _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias) };
+                __m256i mask{ greater ? _mm256_cmpgt_epi16(block, needle) : _mm256_cmpgt_epi16(needle, block) };
+                count += popcount(static_cast<unsigned>(_mm256_movemask_epi8(mask))) / 2; // two mask bits per lane
+            }
+        } else if constexpr(std::is_integral_v<T> && sizeof(T) == 4) {
+            const __m256i bias{ _mm256_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN) };
+            const __m256i needle{ _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(elem)), bias) };
+            for (; i + 8 <= size; i += 8) {
+                __m256i block{ _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias) };
+                __m256i mask{ greater ? _mm256_cmpgt_epi32(block, needle) : _mm256_cmpgt_epi32(needle, block) };
+                count += popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(mask))));
+            }
+        } else if constexpr(std::is_integral_v<T> && sizeof(T) == 8) {
+            const __m256i bias{ _mm256_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN) };
+            const __m256i needle{ _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(elem)), bias) };
+            for (; i + 4 <= size; i += 4) {
+                __m256i block{ _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias) };
+                __m256i mask{ greater ? _mm256_cmpgt_epi64(block, needle) : _mm256_cmpgt_epi64(needle, block) };
+                count += popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(mask))));
+            }
+        } else if constexpr(std::is_same_v<T, float>) {
+            const __m256 needle{ _mm256_set1_ps(elem) };
+            for (; i + 8 <= size; i += 8) {
+                __m256 block{ _mm256_loadu_ps(keys + i) };
+                __m256 mask{ greater ? _mm256_cmp_ps(block, needle, _CMP_GT_OQ) : _mm256_cmp_ps(block, needle, _CMP_LT_OQ) };
+                count += popcount(static_cast<unsigned>(_mm256_movemask_ps(mask)));
+            }
+        } else if constexpr(std::is_same_v<T, double>) {
+            const __m256d needle{ _mm256_set1_pd(elem) };
+            for (; i + 4 <= size; i += 4) {
+                __m256d block{ _mm256_loadu_pd(keys + i) };
+                __m256d mask{ greater ? _mm256_cmp_pd(block, needle, _CMP_GT_OQ) : _mm256_cmp_pd(block, needle, _CMP_LT_OQ) };
+                count += popcount(static_cast<unsigned>(_mm256_movemask_pd(mask)));
+            }
+        }
+#elif defined(__SSE2__)
+        if constexpr(std::is_integral_v<T> && sizeof(T) == 1) {
+            const __m128i bias{ _mm_set1_epi8(std::is_signed_v<T> ? 0 : INT8_MIN) };
+            const __m128i needle{ _mm_xor_si128(_mm_set1_epi8(static_cast<char>(elem)), bias) };
+            for (; i + 16 <= size; i += 16) {
+                __m128i block{ _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias) };
+                __m128i mask{ greater ? _mm_cmpgt_epi8(block, needle) : _mm_cmplt_epi8(block, needle) };
+                count += popcount(static_cast<unsigned>(_mm_movemask_epi8(mask)));
+            }
+        } else if constexpr(std::is_integral_v<T> && sizeof(T) == 2) {
+            const __m128i bias{ _mm_set1_epi16(std::is_signed_v<T> ? 0 : INT16_MIN) };
+            const __m128i needle{ _mm_xor_si128(_mm_set1_epi16(static_cast<short>(elem)), bias) };
+            for (; i + 8 <= size; i += 8) {
+                __m128i block{ _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias) };
+                __m128i mask{ greater ? _mm_cmpgt_epi16(block, needle) : _mm_cmplt_epi16(block, needle) };
+                count += popcount(static_cast<unsigned>(_mm_movemask_epi8(mask))) / 2; // two mask bits per lane
+            }
+        } else if constexpr(std::is_integral_v<T> && sizeof(T) == 4) {
+            const __m128i bias{ _mm_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN) };
+            const __m128i needle{ _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(elem)), bias) };
+            for (; i + 4 <= size; i += 4) {
+                __m128i block{ _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias) };
+                __m128i mask{ greater ? _mm_cmpgt_epi32(block, needle) : _mm_cmplt_epi32(block, needle) };
+                count += popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(mask))));
+            }
+#if defined(__SSE4_2__)
+        } else if constexpr(std::is_integral_v<T> && sizeof(T) == 8) {
+            const __m128i bias{ _mm_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN) };
+            const __m128i needle{ _mm_xor_si128(_mm_set1_epi64x(static_cast<int64_t>(elem)), bias) };
+            for (; i + 2 <= size; i += 2) {
+                __m128i block{ _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias) };
+                __m128i mask{ greater ? _mm_cmpgt_epi64(block, needle) : _mm_cmpgt_epi64(needle, block) };
+                count += popcount(static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(mask))));
+            }
+#endif
+        } else if constexpr(std::is_same_v<T, float>) {
+            const __m128 needle{ _mm_set1_ps(elem) };
+            for (; i + 4 <= size; i += 4) {
+                __m128 block{ _mm_loadu_ps(keys + i) };
+                __m128 mask{ greater ? _mm_cmpgt_ps(block, needle) : _mm_cmplt_ps(block, needle) };
+                count += popcount(static_cast<unsigned>(_mm_movemask_ps(mask)));
+            }
+        } else if constexpr(std::is_same_v<T, double>) {
+            const __m128d needle{ _mm_set1_pd(elem) };
+            for (; i + 2 <= size; i += 2) {
+                __m128d block{ _mm_loadu_pd(keys + i) };
+                __m128d mask{ greater ? _mm_cmpgt_pd(block, needle) : _mm_cmplt_pd(block, needle) };
+                count += popcount(static_cast<unsigned>(_mm_movemask_pd(mask)));
+            }
+        }
+#endif
+        return count + count_scalar<greater>(keys + i, size - i, elem);
+    }
+
+    // number of keys in the sorted range [keys, keys + size) that are less than elem (lower bound),
+    // or not greater than elem if upper (upper bound).
+    // a branchless binary search narrows the range down to a window of about two cache lines,
+    // the window is then counted with count_compare
+    template<bool upper, typename T>
+    inline size_t sorted_rank(const T* keys, size_t size, T elem) {
+        constexpr size_t window{ std::max<size_t>(128 / sizeof(T), 4) };
+        const T* base{ keys };
+        while (size > window) {
+            size_t half{ size / 2 };
+            base = (upper ? !(elem < base[half]) : base[half] < elem) ? base + half : base;
+            size -= half;
+        }
+        size_t offset{ static_cast<size_t>(base - keys) };
+        return offset + (upper ? size - count_compare<true>(base, size, elem) : count_compare<false>(base, size, elem));
+    }
+
+    // whether the comparator C declares is_transparent, which enables the heterogeneous lookups
+    template<typename C, typename = void>
+    struct is_transparent : std::false_type {};
+
+    template<typename C>
+    struct is_transparent<C, std::void_t<typename C::is_transparent>> : std::true_type {};
+
+    // node capacities for a target node size. they mirror the layouts of ADS_set's nodes (tag and size header,
+    // keys plus one overflow slot, then the leaf link or the children plus one overflow slot), are rounded down
+    // to an even number (the minimum fill is half the capacity) and are at least 2. child_size is what an internal
+    // node stores per child, more than the link if it counts the keys below (ADS_SET_ORDER_STATS)
+    constexpr size_t even_capacity(size_t fitting) {
+        return std::max<size_t>(2, fitting & ~size_t{ 1 });
+    }
+
+    constexpr size_t cache_lines(size_t bytes) {
+        return std::max<size_t>(1, (bytes + cache_line_size - 1) / cache_line_size) * cache_line_size;
+    }
+
+    constexpr size_t leaf_capacity(size_t key_size, size_t target_bytes) {
+        size_t bytes{ cache_lines(target_bytes) };
+        size_t fixed{ 2 * sizeof(size_t) + sizeof(void*) + key_size };
+        return even_capacity(bytes > fixed ? (bytes - fixed) / key_size : 0);
+    }
+
+    constexpr size_t internal_capacity(size_t key_size, size_t target_bytes, size_t child_size = sizeof(void*)) {
+        size_t bytes{ cache_lines(target_bytes) };
+        size_t fixed{ 2 * sizeof(size_t) + key_size + 2 * child_size };
+        return even_capacity(bytes > fixed ? (bytes - fixed) / (key_size + child_size) : 0);
+    }
+
+    // fixed-size block arena for the nodes of one tree. blocks are carved from slabs that grow geometrically,
+    // freed blocks go onto an intrusive free list and are reused first, release() hands back all slabs at once
+    template<typename T, typename Allocator>
+    class NodePool {
+        union Block;
+        struct SlabHeader {
+            Block* next;
+            size_t blocks;
+        };
+        union Block {
+            Block* next; // while on the free list
+            SlabHeader slab; // first block of every slab
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+        using block_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+        using block_traits = std::allocator_traits<block_allocator>;
+
+        static constexpr size_t first_slab{ 8 };
+        static constexpr size_t max_slab{ size_t{ 1 } << 16 };
+
+        block_allocator alloc;
+        Block* slabs{ nullptr }; // most recent slab, older ones are chained through the headers
+        Block* free_list{ nullptr };
+        Block* bump{ nullptr }; // never used blocks of the most recent slab
+        Block* bump_end{ nullptr };
+        size_t total_blocks{ 0 };
+
+        void grow() {
+            size_t blocks{ slabs ? std::min(slabs->slab.blocks * 2, max_slab) : first_slab };
+            Block* slab{ block_traits::allocate(alloc, blocks) };
+            slab->slab = SlabHeader{ slabs, blocks };
+            slabs = slab;
+            bump = slab + 1;
+            bump_end = slab + blocks;
+            total_blocks += blocks;
+        }
+
+    public:
+        explicit NodePool(const Allocator& _alloc = Allocator()) : alloc{ _alloc } {}
+
+        NodePool(const NodePool&) = delete;
+
+        NodePool& operator=(const NodePool&) = delete;
+
+        // takes over all slabs of other, which is left empty
+        NodePool(NodePool&& other) noexcept : alloc{ other.alloc } {
+            swap(other);
+        }
+
+        ~NodePool() {
+            release();
+        }
+
+        // uninitialized storage for one T
+        T* allocate() {
+            Block* block;
+            if (free_list) {
+                block = free_list;
+                free_list = free_list->next;
+            } else {
+                if (bump == bump_end) grow();
+                block = bump++;
+            }
+            return reinterpret_cast<T*>(block->storage);
+        }
+
+        // ptr has to be destroyed already
+        void deallocate(T* ptr) {
+            Block* block{ reinterpret_cast<Block*>(ptr) };
+            block->next = free_list;
+            free_list = block;
+        }
+
+        // returns all slabs to the allocator, every T handed out so far has to be destroyed (or trivially destructible)
+        void release() {
+            while (slabs) {
+                Block* slab{ slabs };
+                slabs = slab->slab.next;
+                block_traits::deallocate(alloc, slab, slab->slab.blocks);
+            }
+            free_list = bump = bump_end = nullptr;
+            total_blocks = 0;
+        }
+
+        [[nodiscard]] size_t capacity_bytes() const {
+            return total_blocks * sizeof(Block);
+        }
+
+        [[nodiscard]] Allocator get_allocator() const {
+            return Allocator(alloc);
+        }
+
+        void swap(NodePool& other) {
+            std::swap(alloc, other.alloc);
+            std::swap(slabs, other.slabs);
+            std::swap(free_list, other.free_list);
+            std::swap(bump, other.bump);
+            std::swap(bump_end, other.bump_end);
+            std::swap(total_blocks, other.total_blocks);
+        }
+    };
+
+    // the node layout the B+ trees built on ADS_set's (ADS_map, ADS_buffered_set) have in common: tagged nodes,
+    // internal ones holding keys and children only, and the structural operations on them. each tree brings
+    // its own leaves, which need the same split, borrow and merge interface as IndexNode for rebalance
+    enum class NodeType : unsigned char {
+        INTERNAL,
+        EXTERNAL
+    };
+
+    struct alignas(cache_line_size) TreeNode {
+        NodeType type;
+        size_t size;
+
+        TreeNode(NodeType _type, size_t _size) : type{ _type }, size{ _size } {}
+    };
+
+    // keys[i] separates children[i] and children[i + 1], keys equal to it live right of it
+    template<typename Key, size_t Capacity>
+    struct IndexNode : public TreeNode {
+        static constexpr size_t M{ Capacity }; // max size
+        static constexpr size_t min_size{ M / 2 };
+        Key keys[M + 1]; // temporary invalid nodes require + 1
+        TreeNode* children[M + 2];
+
+        IndexNode() : TreeNode(NodeType::INTERNAL, 0) {}
+
+        // inserts key at ins, the child right of it has to be set by the caller
+        void insert_at(Key&& key, size_t ins) {
+            std::move_backward(keys + ins, keys + size, keys + size + 1);
+            std::copy_backward(children + ins + 1, children + size + 1, children + size + 2);
+            keys[ins] = std::move(key);
+            ++size;
+        }
+
+        // erases the key at and the child right of at, the child has to be freed by the caller
+        void erase_at(size_t at) {
+            std::move(keys + at + 1, keys + size, keys + at);
+            std::copy(children + at + 2, children + size + 1, children + at + 1);
+            --size;
+        }
+
+        // moves everything after split_at to the empty node right, returns the index key for the parent
+        Key split(size_t split_at, IndexNode* right) {
+            right->size = size - split_at - 1;
+            std::move(keys + split_at + 1, keys + size, right->keys);
+            std::copy(children + split_at + 1, children + size + 1, right->children);
+            size = split_at;
+            return std::move(keys[split_at]);
+        }
+
+        // rotates the last count children of left (the left neighbour) and their keys through separator into the
+        // front of this node
+        void borrow_left(Key& separator, IndexNode* left, size_t count) {
+            std::move_backward(keys, keys + size, keys + size + count);
+            std::copy_backward(children, children + size + 1, children + size + 1 + count);
+            keys[count - 1] = std::move(separator);
+            std::move(left->keys + left->size - count + 1, left->keys + left->size, keys);
+            std::copy(left->children + left->size - count + 1, left->children + left->size + 1, children);
+            separator = std::move(left->keys[left->size - count]);
+            left->size -= count;
+            size += count;
+        }
+
+        // rotates the first count children of right (the right neighbour) and their keys through separator onto
+        // the end of this node
+        void borrow_right(Key& separator, IndexNode* right, size_t count) {
+            keys[size] = std::move(separator);
+            std::move(right->keys, right->keys + count - 1, keys + size + 1);
+            std::copy(right->children, right->children + count, children + size + 1);
+            separator = std::move(right->keys[count - 1]);
+            std::move(right->keys + count, right->keys + right->size, right->keys);
+            std::copy(right->children + count, right->children + right->size + 1, right->children);
+            right->size -= count;
+            size += count;
+        }
+
+        // appends pulled_down (the index key between this node and neighbour) and all of neighbour
+        void merge(Key& pulled_down, IndexNode* neighbour) {
+            keys[size++] = std::move(pulled_down);
+            std::move(neighbour->keys, neighbour->keys + neighbour->size, keys + size);
+            std::copy(neighbour->children, neighbour->children + neighbour->size + 1, children + size);
+            size += neighbour->size;
+        }
+    };
+
+    // the index levels of a tree built bottom-up, level holds the nodes of the lowest level (leaves linked left
+    // to right) and mins the smallest key below each of them. the nodes of every level are spread evenly over as
+    // few internal nodes from new_internal as hold them, separator i of a node is the smallest key below child
+    // i + 1. returns the root, level and mins are used up
+    template<typename Key, typename NewInternal>
+    TreeNode* build_index(std::vector<TreeNode*>& level, std::vector<const Key*>& mins, NewInternal&& new_internal) {
+        using Internal = std::remove_pointer_t<std::invoke_result_t<NewInternal&>>;
+        while (level.size() > 1) {
+            size_t nodes{ (level.size() + Internal::M) / (Internal::M + 1) };
+            size_t offset{ 0 };
+            for (size_t i{ 0 }; i < nodes; ++i) {
+                size_t children{ level.size() / nodes + (i < level.size() % nodes ? 1 : 0) };
+                Internal* node{ new_internal() };
+                node->size = children - 1;
+                for (size_t j{ 0 }; j < children; ++j) {
+                    node->children[j] = level[offset + j];
+                    if (j > 0) node->keys[j - 1] = *mins[offset + j];
+                }
+                level[i] = node;
+                mins[i] = mins[offset];
+                offset += children;
+            }
+            level.resize(nodes);
+            mins.resize(nodes);
+        }
+        return level[0];
+    }
+
+    // restores the minimum size of the node parent->children[childpos], a Child, after an erase like
+    // ADS_set::rebalance: the larger neighbour evens out both nodes by handing over entries if it has enough to
+    // spare, otherwise the two are merged. returns the node a merge emptied for the caller to free, else nullptr
+    template<typename Child, typename Parent>
+    Child* rebalance(Parent* parent, size_t childpos) {
+        Child* child{ static_cast<Child*>(parent->children[childpos]) };
+        Child* left{ childpos > 0 ? static_cast<Child*>(parent->children[childpos - 1]) : nullptr };
+        Child* right{ childpos < parent->size ? static_cast<Child*>(parent->children[childpos + 1]) : nullptr };
+        bool from_left{ left && (!right || left->size >= right->size) };
+        Child* neighbour{ from_left ? left : right };
+        if (neighbour->size + child->size >= 2 * Child::min_size) { // both end up with at least min_size entries
+            size_t count{ (neighbour->size - child->size) / 2 };
+            if (from_left) {
+                child->borrow_left(parent->keys[childpos - 1], left, count);
+            } else {
+                child->borrow_right(parent->keys[childpos], right, count);
+            }
+            return nullptr;
+        }
+        if (from_left) {
+            left->merge(parent->keys[childpos - 1], child);
+            parent->erase_at(childpos - 1);
+            return child;
+        }
+        child->merge(parent->keys[childpos], right);
+        parent->erase_at(childpos);
+        return right;
+    }
+
+    // the pools of a tree of Internal and Leaf nodes (both TreeNodes) and the node lifetimes
+    template<typename Internal, typename Leaf, typename Allocator>
+    class NodePools {
+        NodePool<Internal, Allocator> internal_pool;
+        NodePool<Leaf, Allocator> leaf_pool;
+
+        static void destroy(TreeNode* node) {
+            if (node->type == NodeType::INTERNAL) {
+                Internal* internal{ static_cast<Internal*>(node) };
+                for (size_t i{ 0 }; i <= internal->size; ++i) {
+                    destroy(internal->children[i]);
+                }
+                internal->~Internal();
+            } else {
+                static_cast<Leaf*>(node)->~Leaf();
+            }
+        }
+
+    public:
+        explicit NodePools(const Allocator& alloc) : internal_pool{ alloc }, leaf_pool{ alloc } {}
+
+        // takes over all nodes of other, which is left empty
+        NodePools(NodePools&& other) noexcept : internal_pool{ std::move(other.internal_pool) }, leaf_pool{ std::move(other.leaf_pool) } {}
+
+        Internal* new_internal() {
+            return new(internal_pool.allocate()) Internal();
+        }
+
+        Leaf* new_leaf(Leaf* next = nullptr) {
+            return new(leaf_pool.allocate()) Leaf(next);
+        }
+
+        // root of moved-from trees, never written to, the first write replaces it (see ADS_set::empty_root)
+        static Leaf* empty_root() {
+            static Leaf leaf;
+            return &leaf;
+        }
+
+        // frees a single node, its children (if any) have been handed over to another node
+        void free_node(TreeNode* node) {
+            if (node->type == NodeType::INTERNAL) {
+                Internal* internal{ static_cast<Internal*>(node) };
+                internal->~Internal();
+                internal_pool.deallocate(internal);
+            } else {
+                Leaf* leaf{ static_cast<Leaf*>(node) };
+                leaf->~Leaf();
+                leaf_pool.deallocate(leaf);
+            }
+        }
+
+        // drops the tree below root at once: the destructors run unless there are none to run, then the pools hand
+        // back all their slabs
+        void release(TreeNode* root) {
+            if constexpr(!std::is_trivially_destructible_v<Internal> || !std::is_trivially_destructible_v<Leaf>) {
+                if (root && root != empty_root()) destroy(root);
+            }
+            internal_pool.release();
+            leaf_pool.release();
+        }
+
+        [[nodiscard]] Allocator get_allocator() const {
+            return internal_pool.get_allocator();
+        }
+
+        void swap(NodePools& other) {
+            internal_pool.swap(other.internal_pool);
+            leaf_pool.swap(other.leaf_pool);
+        }
+    };
+
+    // nodes and keys of one tree level, fill[i] counts the nodes holding between i and i + 1 tenths of their
+    // key capacity (full ones are in fill[9])
+    struct LevelStats {
+        size_t nodes{ 0 };
+        size_t keys{ 0 };
+        size_t capacity{ 0 };
+        std::array<size_t, 10> fill{};
+    };
+
+    // counted operations, all 0 unless compiled with ADS_SET_STATS
+    struct OpCounts {
+        uint64_t descents{ 0 }; // root to leaf searches, every key of a batch lookup counts as one
+        uint64_t splits{ 0 }; // nodes split off by inserts
+        uint64_t merges{ 0 }; // nodes merged into a neighbour by erases
+        uint64_t borrows{ 0 }; // rebalances that moved keys over from a neighbour instead
+        uint64_t copies{ 0 }; // nodes copied because snapshots shared them
+    };
+
+    // relaxed atomics, so concurrent readers of a set can count their lookups. one add per event, cheap enough
+    // for release builds, but the line is shared by all threads reading the same set
+    struct OpCounters {
+        std::atomic<uint64_t> descents{ 0 };
+        std::atomic<uint64_t> splits{ 0 };
+        std::atomic<uint64_t> merges{ 0 };
+        std::atomic<uint64_t> borrows{ 0 };
+        std::atomic<uint64_t> copies{ 0 };
+
+        [[nodiscard]] OpCounts load() const {
+            return OpCounts{ descents.load(std::memory_order_relaxed), splits.load(std::memory_order_relaxed),
+                             merges.load(std::memory_order_relaxed), borrows.load(std::memory_order_relaxed),
+                             copies.load(std::memory_order_relaxed) };
+        }
+
+        void reset() {
+            descents.store(0, std::memory_order_relaxed);
+            splits.store(0, std::memory_order_relaxed);
+            merges.store(0, std::memory_order_relaxed);
+            borrows.store(0, std::memory_order_relaxed);
+            copies.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // result of ADS_set::stats
+    struct TreeStats {
+        size_t size{ 0 };
+        size_t height{ 0 }; // internal levels above the leaves
+        size_t internal_nodes{ 0 };
+        size_t external_nodes{ 0 };
+        std::vector<LevelStats> levels; // root first, leaves last
+        size_t bytes_allocated{ 0 }; // slabs held by the node pools, including free blocks (the layout, if frozen)
+        double bytes_per_key{ 0 };
+        OpCounts ops;
+    };
+
+    // on-disk format of ADS_set::save, read in place by mapped_ADS_set. the file is a sequence of pages: page 0
+    // holds the FileHeader, every other page one node. nodes refer to each other by page number, so the file can
+    // be mapped at any address. keys are stored as their raw bytes, files are only portable between builds with
+    // the same key type and byte order (which the header checks as far as it can)
+    inline constexpr size_t page_size{ 4096 };
+    inline constexpr char file_magic[8]{ 'A', 'D', 'S', '_', 's', 'e', 't', '\0' };
+    inline constexpr uint32_t file_version{ 1 };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t page_size;
+        uint32_t key_size;
+        uint32_t key_align;
+        uint64_t size; // number of keys
+        uint64_t root; // page of the root node
+        uint64_t height; // levels of nodes, 1 for a single leaf
+        uint64_t pages; // including the header page
+        uint64_t byte_order; // file_byte_order as written
+        uint64_t free_list; // first unused page of an ADS_paged_set file, chained through PageHeader::next, 0 if none
+    };
+
+    inline constexpr uint64_t file_byte_order{ 0x0102030405060708 };
+
+    enum class PageType : uint32_t {
+        INTERNAL = 1,
+        EXTERNAL = 2
+    };
+
+    struct PageHeader {
+        PageType type;
+        uint32_t count; // number of keys
+        uint64_t next; // leaves: page of the next leaf, 0 for the last one
+    };
+
+    // page layout for keys of type Key: leaves hold the keys right after the header, internal nodes the child
+    // page numbers first and the keys behind them
+    template<typename Key>
+    struct PageLayout {
+        static constexpr size_t align(size_t offset) {
+            return (offset + alignof(Key) - 1) / alignof(Key) * alignof(Key);
+        }
+
+        static constexpr size_t leaf_keys{ align(sizeof(PageHeader)) };
+        static constexpr size_t leaf_capacity{ (page_size - leaf_keys) / sizeof(Key) };
+        static constexpr size_t children{ sizeof(PageHeader) };
+        static constexpr size_t internal_capacity{ (page_size - children - sizeof(uint64_t) - (alignof(Key) - 1)) / (sizeof(Key) + sizeof(uint64_t)) };
+        static constexpr size_t internal_keys{ align(children + (internal_capacity + 1) * sizeof(uint64_t)) };
+
+        static_assert(leaf_capacity >= 2 && internal_capacity >= 2, "keys are too large for a page");
+        static_assert(internal_keys + internal_capacity * sizeof(Key) <= page_size);
+
+        static PageHeader* header(unsigned char* page) {
+            return reinterpret_cast<PageHeader*>(page);
+        }
+
+        static const PageHeader* header(const unsigned char* page) {
+            return reinterpret_cast<const PageHeader*>(page);
+        }
+
+        static Key* keys(unsigned char* page) {
+            return reinterpret_cast<Key*>(page + (header(page)->type == PageType::INTERNAL ? internal_keys : leaf_keys));
+        }
+
+        static const Key* keys(const unsigned char* page) {
+            return reinterpret_cast<const Key*>(page + (header(page)->type == PageType::INTERNAL ? internal_keys : leaf_keys));
+        }
+
+        static uint64_t* child_pages(unsigned char* page) {
+            return reinterpret_cast<uint64_t*>(page + children);
+        }
+
+        static const uint64_t* child_pages(const unsigned char* page) {
+            return reinterpret_cast<const uint64_t*>(page + children);
+        }
+
+        // number of keys of the page less than key, or not greater than key if upper
+        template<bool upper>
+        static size_t rank(const unsigned char* page, const Key& key) {
+            const Key* first{ keys(page) };
+            size_t count{ header(page)->count };
+            if constexpr(std::is_arithmetic_v<Key>) {
+                return sorted_rank<upper>(first, count, key);
+            } else if constexpr(upper) {
+                return static_cast<size_t>(std::upper_bound(first, first + count, key, std::less<Key>{}) - first);
+            } else {
+                return static_cast<size_t>(std::lower_bound(first, first + count, key, std::less<Key>{}) - first);
+            }
+        }
+
+        // writes the count keys from first (ascending, unique) as a tree of full pages, bottom-up in a single pass
+        // over the keys. the nodes of every level are filled evenly, like ADS_set::build_tree does
+        template<typename InputIt>
+        static void write(const std::string& path, InputIt first, size_t count) {
+            std::ofstream out{ path, std::ios::binary | std::ios::trunc };
+            if (!out) throw std::runtime_error("cannot open " + path + " for writing");
+            alignas(cache_line_size) unsigned char page[page_size]{};
+            out.write(reinterpret_cast<const char*>(page), page_size); // header, written last
+
+            // leaves, first keys and page numbers of the nodes of the current level are kept for the next one
+            std::vector<Key> firsts;
+            uint64_t next_page{ 1 };
+            size_t nodes{ std::max<size_t>(1, (count + leaf_capacity - 1) / leaf_capacity) };
+            for (size_t i{ 0 }; i < nodes; ++i) {
+                std::memset(page, 0, page_size);
+                PageHeader header{ PageType::EXTERNAL, static_cast<uint32_t>(count / nodes + (i < count % nodes ? 1 : 0)), i + 1 < nodes ? next_page + 1 : 0 };
+                for (uint32_t j{ 0 }; j < header.count; ++j, ++first) {
+                    const Key& key{ *first };
+                    if (j == 0) firsts.push_back(key);
+                    std::memcpy(page + leaf_keys + j * sizeof(Key), &key, sizeof(Key));
+                }
+                std::memcpy(page, &header, sizeof(header));
+                out.write(reinterpret_cast<const char*>(page), page_size);
+                ++next_page;
+            }
+            uint64_t level_begin{ 1 };
+            uint64_t height{ 1 };
+            std::vector<Key> parent_firsts;
+            for (size_t level_nodes{ nodes }; level_nodes > 1; level_nodes = nodes, ++height) {
+                nodes = (level_nodes + internal_capacity) / (internal_capacity + 1);
+                parent_firsts.clear();
+                size_t child{ 0 };
+                for (size_t i{ 0 }; i < nodes; ++i) {
+                    std::memset(page, 0, page_size);
+                    size_t fanout{ level_nodes / nodes + (i < level_nodes % nodes ? 1 : 0) };
+                    PageHeader header{ PageType::INTERNAL, static_cast<uint32_t>(fanout - 1), 0 };
+                    parent_firsts.push_back(firsts[child]);
+                    for (size_t j{ 0 }; j < fanout; ++j, ++child) {
+                        uint64_t child_page{ level_begin + child };
+                        std::memcpy(page + children + j * sizeof(uint64_t), &child_page, sizeof(uint64_t));
+                        if (j > 0) std::memcpy(page + internal_keys + (j - 1) * sizeof(Key), &firsts[child], sizeof(Key));
+                    }
+                    std::memcpy(page, &header, sizeof(header));
+                    out.write(reinterpret_cast<const char*>(page), page_size);
+                }
+                level_begin += level_nodes;
+                next_page += nodes;
+                firsts.swap(parent_firsts);
+            }
+
+            FileHeader header{};
+            std::memcpy(header.magic, file_magic, sizeof(file_magic));
+            header.version = file_version;
+            header.page_size = page_size;
+            header.key_size = sizeof(Key);
+            header.key_align = alignof(Key);
+            header.size = count;
+            header.root = next_page - 1;
+            header.height = height;
+            header.pages = next_page;
+            header.byte_order = file_byte_order;
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.flush();
+            if (!out) throw std::runtime_error("cannot write " + path);
+        }
+    };
+}
+
+// target node sizes of ADS_set<Key> with automatic fanout (N == 0, the default). specialize it for a key type
+// to retune all of its instantiations at once. internal nodes are visited on every descent and should stay
+// small enough to be L1/L2 friendly, leaves are searched once per operation and scanned sequentially
+template<typename Key>
+struct ADS_node_size {
+    static constexpr size_t internal_bytes{ 256 };
+    static constexpr size_t leaf_bytes{ 1024 };
+};
+
+// N for an explicitly sized instantiation, e.g. ADS_set<Key, ADS_fanout<Key>(4096)> for page sized leaves
+template<typename Key>
+constexpr size_t ADS_fanout(size_t leaf_bytes) {
+    return ads_detail::leaf_capacity(sizeof(Key), leaf_bytes) / 2;
+}
+
+// v3, now with 100% less virtual calls!
+// Compare orders the keys like the comparator of std::set. it has to be stateless, every node reaches it as a
+// static member, so it takes no space anywhere. with a transparent comparator (one declaring is_transparent,
+// like std::less<>) the lookups also take keys of other types, e.g. std::string_view for std::string keys,
+// without constructing a key_type
+template<typename Key, size_t N = 0, typename Allocator = std::allocator<Key>, typename Compare = std::less<Key>>
 class ADS_set {
 public:
     class Iterator;
+    class Snapshot;
+    class SnapshotIterator;
 
     using value_type = Key;
     using key_type = Key;
@@ -47,200 +816,1796 @@ public:
     using difference_type = std::ptrdiff_t;
     using iterator = Iterator;
     using const_iterator = Iterator;
-    using key_compare = std::less<key_type>;
-    using key_equal = std::equal_to<key_type>;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using Stats = ads_detail::TreeStats;
+
+    static constexpr double default_fill_factor{ 1.0 }; // bulk loads pack nodes completely full by default
+
+    // whether internal nodes count the keys below each child, compiled in with -DADS_SET_ORDER_STATS. rank, nth
+    // and count_range take O(log n) with the counts and walk the leaf chain without them
+#ifdef ADS_SET_ORDER_STATS
+    static constexpr bool order_statistics{ true };
+#else
+    static constexpr bool order_statistics{ false };
+#endif
+
+    // maximum number of keys per node (the minimum is half of it), N == 0 derives them from ADS_node_size<Key>
+    static constexpr size_type internal_capacity{ N ? 2 * N : ads_detail::internal_capacity(sizeof(Key), ADS_node_size<Key>::internal_bytes,
+                                                                                         sizeof(void*) + (order_statistics ? sizeof(size_t) : 0)) };
+    static constexpr size_type leaf_capacity{ N ? 2 * N : ads_detail::leaf_capacity(sizeof(Key), ADS_node_size<Key>::leaf_bytes) };
 
 private:
-    enum class NodeType {
+    enum class NodeType : unsigned char {
         INTERNAL,
         EXTERNAL
     };
-    enum class InsertState {
-        SUCCESS,
-        EXISTS,
-        TRIGGER_SPLIT
-    };
-    enum class EraseState {
-        SUCCESS,
-        NOT_FOUND,
-        TRIGGER_MERGE
-    };
     struct Node;
+    template<size_type Capacity>
+    struct KeyNode;
     struct InternalNode;
     struct ExternalNode;
+    struct Frozen;
     using link = Node*;
 
-    static constexpr std::equal_to<key_type> eq = key_equal{};
+    // one entry per internal node on the way from the root to a leaf
+    struct PathEntry {
+        InternalNode* node;
+        size_type childpos;
+    };
+    // every non-root node has at least two children -> the height can never exceed the bit width of size_type
+    static constexpr size_type max_height{ std::numeric_limits<size_type>::digits };
+
+    // nodes without non-trivial keys need no destructor calls, their whole arena can be dropped at once
+    static constexpr bool trivial_nodes{ std::is_trivially_destructible_v<key_type> };
+
+    static_assert(std::is_empty_v<key_compare> && std::is_default_constructible_v<key_compare>, "ADS_set needs a stateless comparator");
+
+    // the lookups take key_type, and any other key type only with a transparent comparator, like those of std::set.
+    // the key_type overloads forward to the templates, so that keys converting to key_type still convert
+    template<typename K, typename C = key_compare>
+    using lookup_key = std::enable_if_t<std::is_same_v<K, key_type> || ads_detail::is_transparent<C>::value, int>;
+
+    // shared by a set and its snapshots, created with the first snapshot. snapshots hand back the roots they
+    // were the last owner of through a lock-free list, which only the set drains, so only the set touches
+    // its pools. a set destroyed before its snapshots leaves its pools here, the last snapshot drops them
+    struct SnapshotState {
+        std::atomic<Node*> retired{ nullptr }; // linked through retired_next
+        ads_detail::NodePool<InternalNode, Allocator> internal_pool;
+        ads_detail::NodePool<ExternalNode, Allocator> external_pool;
+
+        explicit SnapshotState(const Allocator& alloc) : internal_pool{ alloc }, external_pool{ alloc } {}
+
+        SnapshotState(const SnapshotState&) = delete;
+
+        SnapshotState& operator=(const SnapshotState&) = delete;
+
+        // nothing but the retired roots (and what only they own) is left in the pools
+        ~SnapshotState() {
+            if constexpr(!trivial_nodes) {
+                for (link node{ retired.load(std::memory_order_acquire) }; node;) {
+                    link next{ retired_next(node) };
+                    drop_keys(node);
+                    node = next;
+                }
+            }
+        }
+
+        void retire(link node) {
+            link head{ retired.load(std::memory_order_relaxed) };
+            do {
+                set_retired_next(node, head);
+            } while (!retired.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        }
+    };
+
+    ads_detail::NodePool<InternalNode, Allocator> internal_pool;
+    ads_detail::NodePool<ExternalNode, Allocator> external_pool;
+    std::shared_ptr<SnapshotState> snapshots; // nullptr as long as no snapshot was taken
     link root;
     size_type sz{};
+    ExternalNode* tail{ nullptr }; // rightmost leaf, nullptr until an insert looks it up again (see last_leaf)
+    std::unique_ptr<Frozen> frozen; // the read-only layout replacing the tree while the set is frozen (see freeze)
+#ifdef ADS_SET_STATS
+    mutable ads_detail::OpCounters counters; // per set, not moved or swapped along with the keys
+#endif
 
-public:
-    ADS_set() : root{ new ExternalNode() }, sz{ 0 } {
-        TRACE_DEB("ADS_set constructed via default constructor")
+    template<typename... Args>
+    InternalNode* new_internal(Args&&... args) {
+        if (snapshots) reclaim();
+        return new(internal_pool.allocate()) InternalNode(std::forward<Args>(args)...);
+    }
+
+    ExternalNode* new_external(ExternalNode* next = nullptr) {
+        if (snapshots) reclaim();
+        tail = nullptr;
+        return new(external_pool.allocate()) ExternalNode(next);
+    }
+
+    // root of moved-from sets, so that moving never allocates. the leaf is shared by all sets of this type,
+    // it is never written to or freed: the first insert replaces it with a leaf of the set's own pool
+    static ExternalNode* empty_root() {
+        static ExternalNode leaf;
+        return &leaf;
+    }
+
+    template<typename ForwardIt>
+    static bool strictly_sorted(ForwardIt first, ForwardIt last) {
+        return std::adjacent_find(first, last, [](const key_type& lhs, const key_type& rhs) { return !Node::cmp(lhs, rhs); }) == last;
+    }
+
+    static void sort_unique(std::vector<key_type>& keys) {
+        std::sort(keys.begin(), keys.end(), Node::cmp);
+        keys.erase(std::unique(keys.begin(), keys.end(), [](const key_type& lhs, const key_type& rhs) { return !Node::cmp(lhs, rhs); }), keys.end());
+    }
+
+    // number of nodes to distribute total entries over, so that no node holds more than per_node (if avoidable)
+    // and no node falls below min_per_node (the root may, if it is the only node)
+    static size_type bulk_node_count(size_type total, size_type per_node, size_type min_per_node) {
+        size_type nodes{ (total + per_node - 1) / per_node };
+        return std::min(nodes, std::max<size_type>(1, total / min_per_node));
+    }
+
+    // builds a tree bottom-up from count sorted, unique keys starting at first
+    template<typename ForwardIt>
+    link build_tree(ForwardIt first, size_type count, double fill_factor) {
+        if (count == 0) return new_external();
+        size_type per_leaf{ ExternalNode::fill(fill_factor) };
+        size_type per_internal{ InternalNode::fill(fill_factor) };
+
+        // leaf level, linked left to right
+        size_type nodes{ bulk_node_count(count, per_leaf, ExternalNode::min_size) };
+        std::vector<link> level;
+        std::vector<const key_type*> mins; // smallest key of each subtree on the current level
+        level.reserve(nodes);
+        mins.reserve(nodes);
+        ExternalNode* prev{ nullptr };
+        for (size_type i{ 0 }; i < nodes; ++i) {
+            ExternalNode* leaf{ new_external() };
+            leaf->size = count / nodes + (i < count % nodes ? 1 : 0);
+            for (size_type j{ 0 }; j < leaf->size; ++j, ++first) {
+                leaf->values[j] = *first;
+            }
+            if (prev) prev->next = leaf;
+            prev = leaf;
+            level.push_back(leaf);
+            mins.push_back(leaf->values);
+        }
+
+        // index levels, separator i of a node is the smallest key in child i + 1
+        while (level.size() > 1) {
+            nodes = bulk_node_count(level.size(), per_internal + 1, InternalNode::min_size + 1);
+            size_type offset{ 0 };
+            for (size_type i{ 0 }; i < nodes; ++i) {
+                size_type children{ level.size() / nodes + (i < level.size() % nodes ? 1 : 0) };
+                InternalNode* node{ new_internal(level.data() + offset, children - 1) };
+                for (size_type j{ 1 }; j < children; ++j) {
+                    node->values[j - 1] = *mins[offset + j];
+                }
+                level[i] = node;
+                mins[i] = mins[offset];
+                offset += children;
+            }
+            level.resize(nodes);
+            mins.resize(nodes);
+        }
+        TRACE_DEB("Bulk load built " << nodes << " root node(s) from " << count << " keys")
+        return level[0];
+    }
+
+    void replace_root(link new_root, size_type new_size) {
+        tail = nullptr;
+        frozen.reset();
+        release(root);
+        root = new_root;
+        sz = new_size;
+    }
+
+    // static dispatch on the node tag, replaces the former virtual interface of Node
+
+    // every node counts its owners in refs: its parent (or the set, for the root) and each snapshot holding
+    // it as its root. nodes with more than one owner are shared with snapshots and are never written,
+    // except for the next link of leaves, which snapshots do not read
+    static bool shared(link node) {
+        return node->refs.load(std::memory_order_acquire) > 1;
+    }
+
+    // drops one owner of node, which is freed together with everything only it owned once the last one is gone
+    void release(link node) {
+        if (!node || node == empty_root()) return;
+        if (node->refs.load(std::memory_order_acquire) != 1 && node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            for (size_type i{ 0 }; i <= internal->size; ++i) {
+                release(internal->children[i]);
+            }
+        }
+        free_node(node);
+    }
+
+    // runs the destructors of all nodes below (and including) node without returning them to the pools,
+    // the pools are released as a whole afterwards
+    static void destroy_keys(link node) {
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            for (size_type i{ 0 }; i <= internal->size; ++i) {
+                destroy_keys(internal->children[i]);
+            }
+            internal->~InternalNode();
+        } else {
+            static_cast<ExternalNode*>(node)->~ExternalNode();
+        }
+    }
+
+    // like destroy_keys for a node without owners, but keeps the nodes other owners still hold
+    static void drop_keys(link node) {
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            for (size_type i{ 0 }; i <= internal->size; ++i) {
+                if (internal->children[i]->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) drop_keys(internal->children[i]);
+            }
+            internal->~InternalNode();
+        } else {
+            static_cast<ExternalNode*>(node)->~ExternalNode();
+        }
+    }
+
+    // retired nodes are dead, they are chained through a link field that is unused by then
+    static link retired_next(link node) {
+        if (node->type == NodeType::INTERNAL) return static_cast<InternalNode*>(node)->children[InternalNode::M + 1];
+        return static_cast<ExternalNode*>(node)->next;
+    }
+
+    static void set_retired_next(link node, link next) {
+        if (node->type == NodeType::INTERNAL) {
+            static_cast<InternalNode*>(node)->children[InternalNode::M + 1] = next;
+        } else {
+            static_cast<ExternalNode*>(node)->next = static_cast<ExternalNode*>(next);
+        }
+    }
+
+    // frees the roots released snapshots have handed back, with everything below them that only they owned
+    void reclaim() {
+        if (!snapshots->retired.load(std::memory_order_relaxed)) return;
+        for (link node{ snapshots->retired.exchange(nullptr, std::memory_order_acquire) }; node;) {
+            link next{ retired_next(node) };
+            if (node->type == NodeType::INTERNAL) {
+                InternalNode* internal{ static_cast<InternalNode*>(node) };
+                for (size_type i{ 0 }; i <= internal->size; ++i) {
+                    release(internal->children[i]);
+                }
+            }
+            free_node(node);
+            node = next;
+        }
+    }
+
+    // drops the whole tree, O(1) in the number of nodes for trivially destructible keys. nodes still shared
+    // with snapshots have to stay, then the tree is released node by node
+    void release_all() {
+        tail = nullptr;
+        frozen.reset();
+        if (snapshots) {
+            reclaim();
+            if (snapshots.use_count() > 1) {
+                release(root);
+                root = nullptr;
+                return;
+            }
+        }
+        if constexpr(!trivial_nodes) {
+            if (root && root != empty_root()) destroy_keys(root);
+        }
+        internal_pool.release();
+        external_pool.release();
+        root = nullptr;
+    }
+
+    // copy of a node shared with snapshots, owned by this set alone. the children gain the copy as owner,
+    // the original loses this set
+    InternalNode* clone(InternalNode* node) {
+        ADS_SET_COUNT(copies, 1)
+        InternalNode* copy{ new_internal(*node) };
+        for (size_type i{ 0 }; i <= node->size; ++i) {
+            node->children[i]->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        release(node);
+        return copy;
+    }
+
+    // predecessor is the leaf before leaf in this set, it is relinked to the copy
+    ExternalNode* clone(ExternalNode* leaf, ExternalNode* predecessor) {
+        ADS_SET_COUNT(copies, 1)
+        ExternalNode* copy{ new_external(leaf->next) };
+        std::copy(leaf->values, leaf->values + leaf->size, copy->values);
+        copy->size = leaf->size;
+        if (predecessor) predecessor->next = copy;
+        release(leaf);
+        return copy;
+    }
+
+    // the leaf left of path[level].node->children[childpos] (which is a leaf), nullptr for the leftmost one
+    static ExternalNode* leaf_before(const PathEntry* path, size_type level, size_type childpos) {
+        link node{ childpos > 0 ? path[level].node->children[childpos - 1] : nullptr };
+        for (; !node && level > 0; --level) {
+            if (path[level - 1].childpos > 0) node = path[level - 1].node->children[path[level - 1].childpos - 1];
+        }
+        if (!node) return nullptr;
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            node = internal->children[internal->size];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // makes the nodes on path and leaf below them exclusive to this set before they are written, cloning the
+    // ones still shared with snapshots top-down (path copying). returns leaf or its copy
+    ExternalNode* unshare(PathEntry* path, size_type depth, ExternalNode* leaf) {
+        if (!snapshots) return leaf;
+        link* slot{ &root };
+        for (size_type level{ 0 }; level < depth; ++level) {
+            if (shared(*slot)) *slot = clone(static_cast<InternalNode*>(*slot));
+            path[level].node = static_cast<InternalNode*>(*slot);
+            slot = path[level].node->children + path[level].childpos;
+        }
+        if (shared(*slot)) *slot = clone(static_cast<ExternalNode*>(*slot), depth > 0 ? leaf_before(path, depth - 1, path[depth - 1].childpos) : nullptr);
+        return static_cast<ExternalNode*>(*slot);
+    }
+
+    // the same for the child at pos of the (exclusive) node path[level].node
+    template<typename Child>
+    Child* unshare_child(const PathEntry* path, size_type level, size_type pos) {
+        link& slot{ path[level].node->children[pos] };
+        if (snapshots && shared(slot)) {
+            if constexpr(std::is_same_v<Child, InternalNode>) {
+                slot = clone(static_cast<InternalNode*>(slot));
+            } else {
+                slot = clone(static_cast<ExternalNode*>(slot), leaf_before(path, level, pos));
+            }
+        }
+        return static_cast<Child*>(slot);
+    }
+
+    // frees a single node, its children (if any) have been handed over to another node
+    void free_node(link node) {
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            internal->~InternalNode();
+            internal_pool.deallocate(internal);
+        } else {
+            ExternalNode* external{ static_cast<ExternalNode*>(node) };
+            external->~ExternalNode();
+            external_pool.deallocate(external);
+            tail = nullptr;
+        }
+    }
+
+    // splits node after index split_at, returns the new right neighbour and the index key for the parent
+    std::pair<link, key_type*> split(link node, size_type split_at) {
+        ADS_SET_COUNT(splits, 1)
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            InternalNode* right{ new_internal(internal->children + split_at + 1, internal->size - split_at - 1) };
+            return std::pair<link, key_type*>(right, internal->split(split_at, right));
+        }
+        ExternalNode* external{ static_cast<ExternalNode*>(node) };
+        ExternalNode* right{ new_external(external->next) };
+        external->split(split_at, right);
+        return std::pair<link, key_type*>(right, right->values);
+    }
+
+    std::pair<link, key_type*> split(link node) {
+        return split(node, (node->size - 1) / 2); // size to index conversion
+    }
+
+    // the index key of a split for the parent: a split internal node hands over its middle key (it is no longer
+    // part of the node), a split leaf keeps it as the first key of the right node
+    static key_type index_key(const std::pair<link, key_type*>& splitres) {
+        if (splitres.first->type == NodeType::INTERNAL) return std::move(*splitres.second);
+        return *splitres.second;
+    }
+
+    // appends all elements of right to left, pulled_down is the index key between them in the parent
+    // (it is moved from, the parent drops or overwrites it afterwards)
+    static void merge(link left, key_type& pulled_down, link right) {
+        if (left->type == NodeType::INTERNAL) {
+            static_cast<InternalNode*>(left)->merge(std::move(pulled_down), static_cast<InternalNode*>(right));
+        } else {
+            static_cast<ExternalNode*>(left)->merge(static_cast<ExternalNode*>(right));
+        }
+    }
+
+    // number of keys below node, only available with ADS_SET_ORDER_STATS
+    static size_type subtree_size(link node) {
+        if (node->type == NodeType::EXTERNAL) return node->size;
+        return static_cast<InternalNode*>(node)->total();
+    }
+
+    // adds count keys (or removes them, if !added) to the counts of the nodes on path. no-op without
+    // ADS_SET_ORDER_STATS, splits and merges below are recounted separately
+    static void count_path([[maybe_unused]] const PathEntry* path, [[maybe_unused]] size_type depth,
+                           [[maybe_unused]] size_type count, [[maybe_unused]] bool added) {
+#ifdef ADS_SET_ORDER_STATS
+        for (size_type level{ 0 }; level < depth; ++level) {
+            size_type& keys{ path[level].node->counts[path[level].childpos] };
+            keys = added ? keys + count : keys - count;
+        }
+#endif
+    }
+
+    // iterator to position pos of leaf, pos == size continues at the first element of the next leaf
+    static iterator leaf_iterator(ExternalNode* leaf, size_type pos) {
+        if (pos < leaf->size) return Iterator(leaf, pos);
+        return leaf->next ? Iterator(leaf->next, 0) : Iterator();
+    }
+
+    template<typename K>
+    ExternalNode* find_leaf(const K& key) const {
+        ADS_SET_COUNT(descents, 1)
+        return find_leaf(root, key);
+    }
+
+    // the same below any node, snapshots descend from their own root
+    template<typename K>
+    static ExternalNode* find_leaf(link node, const K& key) {
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            node = internal->children[internal->find_child_pos(key)];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // the leaf after the one holding key (below node), nullptr if that one is the last. the leaf chain can not be
+    // used for this below a snapshot root, the next links always lead through the current leaves of the set
+    static ExternalNode* next_leaf(link node, const key_type& key) {
+        link right{ nullptr }; // right neighbour of the subtree the descent is in
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ internal->find_child_pos(key) };
+            if (childpos < internal->size) right = internal->children[childpos + 1];
+            node = internal->children[childpos];
+        }
+        if (!right) return nullptr;
+        while (right->type == NodeType::INTERNAL) {
+            right = static_cast<InternalNode*>(right)->children[0];
+        }
+        return static_cast<ExternalNode*>(right);
+    }
+
+    // number of internal levels above the leaves, all leaves are on the same level
+    size_type height() const {
+        size_type levels{ 0 };
+        for (link node{ root }; node->type == NodeType::INTERNAL; node = static_cast<InternalNode*>(node)->children[0]) {
+            ++levels;
+        }
+        return levels;
+    }
+
+    // keys per node of the frozen index and per block of frozen keys: a cache line of them, at least 8. frozen
+    // leaves hold as many whole blocks as fit, so that no block spans two leaves
+    static constexpr size_type frozen_block{ std::min<size_type>(leaf_capacity, std::max<size_type>(8, ads_detail::cache_line_size / sizeof(key_type))) };
+    static constexpr size_type frozen_fill{ leaf_capacity - leaf_capacity % frozen_block };
+
+    // number of keys in the sorted range [keys, keys + size) less than key, or not greater than key if upper
+    template<bool upper, typename K>
+    static size_type frozen_search(const key_type* keys, size_type size, const K& key) {
+        if constexpr(ExternalNode::template kernel_search<K>) {
+            return ads_detail::sorted_rank<upper>(keys, size, key);
+        } else if constexpr(upper) {
+            return static_cast<size_type>(std::upper_bound(keys, keys + size, key, Node::cmp) - keys);
+        } else {
+            return static_cast<size_type>(std::lower_bound(keys, keys + size, key, Node::cmp) - keys);
+        }
+    }
+
+    // key at position of a frozen set, counted from 0
+    const key_type& frozen_key(size_type position) const {
+        return frozen->leaves[position / frozen_fill].values[position % frozen_fill];
+    }
+
+    // iterator to the key at position of a frozen set, end() past the last one
+    iterator frozen_iterator(size_type position) const {
+        if (position >= sz) return Iterator();
+        return Iterator(&frozen->leaves[position / frozen_fill], position % frozen_fill);
+    }
+
+    // number of keys less than key (not greater than key, if upper) in a frozen set. every index level costs
+    // one search in a single node, the child follows from the node and the result without loading a link.
+    // the descent ends at a block of keys, which is searched the same way
+    template<bool upper, typename K>
+    size_type frozen_rank(const K& key) const {
+        ADS_SET_COUNT(descents, 1)
+        if (sz == 0) return 0;
+        const key_type* index{ frozen->index.data() };
+        size_type child{ 0 };
+        for (const typename Frozen::Level& level: frozen->levels) {
+            size_type first{ child * (frozen_block + 1) };
+            size_type separators{ std::min(frozen_block + 1, level.children - first) - 1 };
+            child = first + frozen_search<true>(index + level.offset + child * frozen_block, separators, key);
+        }
+        size_type position{ child * frozen_block };
+        return position + frozen_search<upper>(&frozen_key(position), std::min(frozen_block, sz - position), key);
+    }
+
+    // position of key in a frozen set, sz if it is not contained. writes that would change nothing are answered
+    // through this, so that they keep the frozen layout
+    template<typename K>
+    size_type frozen_find(const K& key) const {
+        size_type position{ frozen_rank<false>(key) };
+        return position < sz && !Node::cmp(key, frozen_key(position)) ? position : sz;
+    }
+
+    // stats of the frozen layout, index nodes count as internal nodes
+    void frozen_stats(Stats& result) const {
+        for (const typename Frozen::Level& level: frozen->levels) {
+            ads_detail::LevelStats& current{ result.levels.emplace_back() };
+            current.capacity = frozen_block;
+            for (size_type first{ 0 }; first < level.children; first += frozen_block + 1) {
+                size_type keys{ std::min(frozen_block + 1, level.children - first) - 1 };
+                ++current.nodes;
+                current.keys += keys;
+                ++current.fill[std::min<size_type>(current.fill.size() - 1, keys * current.fill.size() / current.capacity)];
+            }
+            result.internal_nodes += current.nodes;
+        }
+        ads_detail::LevelStats& leaves{ result.levels.emplace_back() };
+        leaves.capacity = ExternalNode::M;
+        for (const ExternalNode& leaf: frozen->leaves) {
+            ++leaves.nodes;
+            leaves.keys += leaf.size;
+            ++leaves.fill[std::min<size_type>(leaves.fill.size() - 1, leaf.size * leaves.fill.size() / leaves.capacity)];
+        }
+        result.external_nodes = leaves.nodes;
+        result.height = result.levels.size() - 1;
+        result.bytes_allocated = frozen->leaves.capacity() * sizeof(ExternalNode) + frozen->index.capacity() * sizeof(key_type);
+        result.bytes_per_key = sz ? static_cast<double>(result.bytes_allocated) / static_cast<double>(sz) : 0.0;
+#ifdef ADS_SET_STATS
+        result.ops = counters.load();
+#endif
+    }
+
+    // lookups of a batch that advance through the tree side by side
+    static constexpr size_type lookup_group{ 16 };
+
+    // prefetches what the search in node will touch first: internal nodes as a whole (they are small),
+    // leaves only their header and the line of the first binary search probe
+    static void prefetch_for_search(link node, bool leaf) {
+        if (leaf) {
+            ads_detail::prefetch(node, ads_detail::cache_line_size);
+            ads_detail::prefetch(static_cast<ExternalNode*>(node)->values + ExternalNode::M / 2, ads_detail::cache_line_size);
+        } else {
+            ads_detail::prefetch(node, std::min(sizeof(InternalNode), 4 * ads_detail::cache_line_size));
+        }
+    }
+
+    // calls emit(leaf, leaf->findpos(key)) for every key in [first, last), in input order
+    template<typename ForwardIt, typename Emit>
+    void lookup_many(ForwardIt first, ForwardIt last, Emit&& emit) const {
+        static_assert(std::is_same_v<typename std::iterator_traits<ForwardIt>::value_type, key_type>, "batch lookups need a range of key_type");
+        if (frozen) { // there are no nodes to share or prefetch along, the upper index levels stay cached anyway
+            for (; first != last; ++first) {
+                size_type position{ frozen_rank<false>(*first) };
+                if (position < sz && !Node::cmp(*first, frozen_key(position))) {
+                    Iterator it{ frozen_iterator(position) };
+                    emit(it.current, static_cast<int>(it.pos));
+                } else {
+                    emit(nullptr, -1);
+                }
+            }
+            return;
+        }
+        // sharing the path only pays off if consecutive keys are likely to hit the same leaves,
+        // sparse sorted batches are better off overlapping their misses like unsorted ones
+        size_type count{ static_cast<size_type>(std::distance(first, last)) };
+        ADS_SET_COUNT(descents, count)
+        bool dense{ count * ExternalNode::M >= sz };
+        if (dense && std::is_sorted(first, last, Node::cmp)) {
+            lookup_sorted(first, last, emit);
+        } else {
+            lookup_grouped(first, last, emit);
+        }
+    }
+
+    // up to lookup_group lookups descend level by level together, each one prefetching its next node before
+    // the others take their step, so the cache misses of a group overlap instead of adding up
+    template<typename ForwardIt, typename Emit>
+    void lookup_grouped(ForwardIt first, ForwardIt last, Emit& emit) const {
+        const size_type levels{ height() };
+        const key_type* keys[lookup_group];
+        link nodes[lookup_group];
+        while (first != last) {
+            size_type count{ 0 };
+            for (; first != last && count < lookup_group; ++first, ++count) {
+                keys[count] = &*first;
+                nodes[count] = root;
+            }
+            for (size_type level{ 1 }; level <= levels; ++level) {
+                for (size_type i{ 0 }; i < count; ++i) {
+                    InternalNode* internal{ static_cast<InternalNode*>(nodes[i]) };
+                    nodes[i] = internal->children[internal->find_child_pos(*keys[i])];
+                    prefetch_for_search(nodes[i], level == levels);
+                }
+            }
+            for (size_type i{ 0 }; i < count; ++i) {
+                ExternalNode* leaf{ static_cast<ExternalNode*>(nodes[i]) };
+                emit(leaf, leaf->findpos(*keys[i]));
+            }
+        }
+    }
+
+    // sorted batches keep the path of the previous lookup together with the upper key bound of every node on it,
+    // the next lookup only descends again from the deepest node whose range still contains its key
+    template<typename ForwardIt, typename Emit>
+    void lookup_sorted(ForwardIt first, ForwardIt last, Emit& emit) const {
+        link nodes[max_height + 1];
+        const key_type* fences[max_height + 1]; // exclusive upper bound of the keys below nodes[l], nullptr if unbounded
+        nodes[0] = root;
+        fences[0] = nullptr;
+        size_type depth{ 0 };
+        for (; first != last; ++first) {
+            const key_type& key{ *first };
+            size_type level{ depth };
+            while (level > 0 && fences[level] && !Node::cmp(key, *fences[level])) {
+                --level;
+            }
+            link node{ nodes[level] };
+            while (node->type == NodeType::INTERNAL) {
+                InternalNode* internal{ static_cast<InternalNode*>(node) };
+                size_type childpos{ internal->find_child_pos(key) };
+                fences[level + 1] = childpos < internal->size ? internal->values + childpos : fences[level];
+                node = internal->children[childpos];
+                nodes[++level] = node;
+            }
+            depth = level;
+            ExternalNode* leaf{ static_cast<ExternalNode*>(node) };
+            emit(leaf, leaf->findpos(key));
+        }
+    }
+
+    // descends to the leaf responsible for key, recording the internal nodes on the way in path
+    template<typename K>
+    ExternalNode* find_leaf(const K& key, PathEntry* path, size_type& depth) const {
+        ADS_SET_COUNT(descents, 1)
+        link node{ root };
+        depth = 0;
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ internal->find_child_pos(key) };
+            path[depth++] = PathEntry{ internal, childpos };
+            node = internal->children[childpos];
+        }
+        return static_cast<ExternalNode*>(node);
+    }
+
+    // the rightmost leaf. the cache is dropped whenever a leaf is allocated or freed, as either may change it
+    ExternalNode* last_leaf() {
+        if (!tail) {
+            link node{ root };
+            while (node->type == NodeType::INTERNAL) {
+                InternalNode* internal{ static_cast<InternalNode*>(node) };
+                node = internal->children[internal->size];
+            }
+            tail = static_cast<ExternalNode*>(node);
+        }
+        return tail;
+    }
+
+    // leaf if key certainly belongs into it without a descent: not less than its first key, and less than its
+    // last one unless leaf is the last leaf (the separator to the next leaf may lie anywhere in between).
+    // nullptr otherwise, and always while there are snapshots or order statistics, as writing a leaf may need
+    // the path to it
+    ExternalNode* hinted_leaf(ExternalNode* leaf, const key_type& key) const {
+        if (!leaf || order_statistics || snapshots || leaf->size == 0 || Node::cmp(key, leaf->values[0])) return nullptr;
+        if (leaf->next && !Node::cmp(key, leaf->values[leaf->size - 1])) return nullptr;
+        return leaf;
+    }
+
+    // index of the split of a node that overflowed to size. ascending inserts into the last leaf split it near
+    // the end instead of in the middle, the right node only gets a tenth of the keys, so time ordered keys leave
+    // (almost) full nodes behind instead of half empty ones. both halves may be below min_size then, which
+    // rebalance copes with like with any other underfull node
+    static size_type split_position(size_type size, bool append) {
+        return append ? size - 1 - std::max<size_type>(1, size / 10) : (size - 1) / 2;
+    }
+
+    // inserts key (copied or moved) if it is not contained yet. hint is a leaf the key is expected in, without
+    // one the last leaf is tried: if that leaf is certainly the right one and has room, there is no descent
+    template<typename K>
+    std::pair<iterator, bool> insert_unique(K&& key, ExternalNode* hint = nullptr) {
+        TRACE_INF("Inserting element: " << key)
+        TRACE_DEB("Size (prev): " << sz)
+        if (frozen) {
+            if (size_type position{ frozen_find(key) }; position < sz) return std::pair<iterator, bool>(frozen_iterator(position), false);
+            thaw();
+            hint = nullptr; // it pointed into the frozen leaves
+        }
+
+        if (ExternalNode* leaf{ hinted_leaf(hint ? hint : last_leaf(), key) }; leaf && leaf->size < ExternalNode::M) {
+            int pos{ leaf->findpos(key) };
+            if (pos >= 0) return std::pair<iterator, bool>(Iterator(leaf, static_cast<size_type>(pos)), false);
+            size_type inv_pos{ static_cast<size_type>(invert(pos)) };
+            leaf->insert_at(std::forward<K>(key), inv_pos);
+            ++sz;
+            TRACE_DEB("Hinted insert successful")
+            return std::pair<iterator, bool>(Iterator(leaf, inv_pos), true);
+        }
+
+        if (root == empty_root()) root = new_external();
+        PathEntry path[max_height];
+        size_type depth;
+        ExternalNode* leaf{ find_leaf(key, path, depth) };
+        int pos{ leaf->findpos(key) };
+        if (pos >= 0) {
+            TRACE_DEB("Insert ignored, element exists already")
+            return std::pair<iterator, bool>(Iterator(leaf, static_cast<size_type>(pos)), false);
+        }
+        size_type inv_pos{ static_cast<size_type>(invert(pos)) };
+        leaf = unshare(path, depth, leaf);
+        leaf->insert_at(std::forward<K>(key), inv_pos);
+        ++sz;
+        count_path(path, depth, 1, true);
+        if (leaf->size <= ExternalNode::M) {
+            TRACE_DEB("Insert successful without split")
+            return std::pair<iterator, bool>(Iterator(leaf, inv_pos), true);
+        }
+
+        // split upwards as long as the nodes on the path are temporarily invalid. only the leaf split moves the
+        // inserted key, into the right node if it lies beyond split_at: the iterator is remapped right there,
+        // internal splits move links only, so the insert costs a single descent whether it splits or not
+        bool append{ !leaf->next && inv_pos > split_position(leaf->size, true) };
+        size_type split_at{ split_position(leaf->size, append) };
+        std::pair<link, key_type*> splitres{ split(leaf, split_at) };
+        Iterator inserted{ inv_pos <= split_at ? Iterator(leaf, inv_pos) : Iterator(static_cast<ExternalNode*>(splitres.first), inv_pos - split_at - 1) };
+        while (depth > 0) {
+            PathEntry& parent{ path[--depth] };
+            parent.node->insert_at(index_key(splitres), parent.childpos);
+            parent.node->children[parent.childpos + 1] = splitres.first;
+            parent.node->recount(parent.childpos, parent.childpos + 1);
+            if (parent.node->size <= InternalNode::M) {
+                return std::pair<iterator, bool>(inserted, true);
+            }
+            splitres = split(parent.node, split_position(parent.node->size, append));
+        }
+        TRACE_DEB("Insert triggered root split")
+        root = new_internal(index_key(splitres), root, splitres.first);
+        return std::pair<iterator, bool>(inserted, true);
+    }
+
+    // restores the minimum size of the child (of type Child) path[level] leads to after an erase. the larger
+    // neighbour evens out both nodes by handing over keys if it has enough to spare, otherwise the two are merged.
+    // both happen in place in the sibling arrays, nothing is allocated unless the neighbour is shared with snapshots
+    template<typename Child>
+    void rebalance(PathEntry* path, size_type level) {
+        InternalNode* parent{ path[level].node };
+        size_type childpos{ path[level].childpos };
+        Child* child{ static_cast<Child*>(parent->children[childpos]) };
+        Child* left{ childpos > 0 ? static_cast<Child*>(parent->children[childpos - 1]) : nullptr };
+        Child* right{ childpos < parent->size ? static_cast<Child*>(parent->children[childpos + 1]) : nullptr };
+        bool from_left{ left && (!right || left->size >= right->size) };
+        if (from_left) {
+            left = unshare_child<Child>(path, level, childpos - 1);
+        } else {
+            right = unshare_child<Child>(path, level, childpos + 1);
+        }
+        Child* neighbour{ from_left ? left : right };
+        if (neighbour->size + child->size >= 2 * Child::min_size) { // both end up with at least min_size keys
+            ADS_SET_COUNT(borrows, 1)
+            size_type count{ (neighbour->size - child->size) / 2 };
+            if (from_left) {
+                child->borrow_left(parent->values[childpos - 1], left, count);
+                parent->recount(childpos - 1, childpos);
+            } else {
+                child->borrow_right(parent->values[childpos], right, count);
+                parent->recount(childpos, childpos + 1);
+            }
+        } else if (from_left) { // fits into one node (M is even), including a pulled-down index key
+            ADS_SET_COUNT(merges, 1)
+            merge(left, parent->values[childpos - 1], child);
+            free_node(child);
+            parent->erase_at(childpos - 1);
+            parent->recount(childpos - 1, childpos - 1);
+        } else {
+            ADS_SET_COUNT(merges, 1)
+            merge(child, parent->values[childpos], right);
+            free_node(right);
+            parent->erase_at(childpos);
+            parent->recount(childpos, childpos);
+        }
+    }
+
+    // exclusive upper bound of the keys below the node a descent ended in, nullptr if unbounded
+    static const key_type* upper_fence(const PathEntry* path, size_type depth) {
+        for (; depth > 0; --depth) {
+            const PathEntry& entry{ path[depth - 1] };
+            if (entry.childpos < entry.node->size) return entry.node->values + entry.childpos;
+        }
+        return nullptr;
+    }
+
+    // nodes created by a batch insert that still have to be linked into their parent, with their index keys
+    using PendingChildren = std::vector<std::pair<key_type, link>>;
+
+    // spreads keys evenly over leaf and as few new right neighbours as possible
+    void distribute_leaf(ExternalNode* leaf, std::vector<key_type>& keys, PendingChildren& pending) {
+        size_type nodes{ (keys.size() + ExternalNode::M - 1) / ExternalNode::M };
+        ADS_SET_COUNT(splits, nodes - 1)
+        size_type offset{ 0 };
+        ExternalNode* current{ leaf };
+        for (size_type i{ 0 }; i < nodes; ++i) {
+            if (i > 0) {
+                ExternalNode* right{ new_external(current->next) };
+                current->next = right;
+                current = right;
+                pending.emplace_back(keys[offset], right);
+            }
+            current->size = keys.size() / nodes + (i < keys.size() % nodes ? 1 : 0);
+            for (size_type j{ 0 }; j < current->size; ++j) {
+                current->values[j] = std::move(keys[offset + j]);
+            }
+            offset += current->size;
+        }
+    }
+
+    // links the pending children into node right of node->children[childpos]. if node overflows, its keys and
+    // children are spread over node and as few new right neighbours as possible, which are then pending themselves
+    void insert_children(InternalNode* node, size_type childpos, PendingChildren& pending, PendingChildren& next_pending,
+                         std::vector<key_type>& keys, std::vector<link>& links) {
+        next_pending.clear();
+        if (node->size + pending.size() <= InternalNode::M) {
+            for (size_type i{ 0 }; i < pending.size(); ++i) {
+                node->insert_at(std::move(pending[i].first), childpos + i);
+                node->children[childpos + i + 1] = pending[i].second;
+            }
+            node->recount(childpos, childpos + pending.size());
+            pending.clear();
+            return;
+        }
+
+        // keys[i] separates links[i] and links[i + 1]
+        keys.clear();
+        links.clear();
+        std::move(node->values, node->values + childpos, std::back_inserter(keys));
+        links.insert(links.end(), node->children, node->children + childpos + 1);
+        for (std::pair<key_type, link>& child : pending) {
+            keys.push_back(std::move(child.first));
+            links.push_back(child.second);
+        }
+        std::move(node->values + childpos, node->values + node->size, std::back_inserter(keys));
+        links.insert(links.end(), node->children + childpos + 1, node->children + node->size + 1);
+
+        size_type nodes{ (links.size() + InternalNode::M) / (InternalNode::M + 1) };
+        ADS_SET_COUNT(splits, nodes - 1)
+        size_type offset{ 0 };
+        for (size_type i{ 0 }; i < nodes; ++i) {
+            size_type children{ links.size() / nodes + (i < links.size() % nodes ? 1 : 0) };
+            InternalNode* current{ node };
+            if (i > 0) {
+                current = new_internal(links.data() + offset, children - 1);
+                next_pending.emplace_back(std::move(keys[offset - 1]), current);
+            } else {
+                std::copy(links.data(), links.data() + children, node->children);
+                node->size = children - 1;
+            }
+            for (size_type j{ 0 }; j + 1 < children; ++j) {
+                current->values[j] = std::move(keys[offset + j]);
+            }
+            offset += children;
+        }
+        node->recount(0, node->size);
+        pending.swap(next_pending);
+    }
+
+    // set algebra on fewer keys than this stays on the calling thread
+    static constexpr size_type parallel_threshold{ size_type{ 1 } << 16 };
+    static constexpr size_type ranges_per_thread{ 4 }; // evens out ranges of different cost
+
+    // about count separators of the highest index level holding that many, in ascending order. the key space is
+    // cut at them into ranges of roughly equal size (of this set). a frozen set picks evenly spaced keys instead
+    std::vector<key_type> splitters(size_type count) const {
+        std::vector<key_type> keys;
+        if (frozen) {
+            for (size_type i{ 1 }; i <= count && count < sz; ++i) {
+                keys.push_back(frozen_key(i * sz / (count + 1)));
+            }
+            return keys;
+        }
+        std::vector<link> level{ root };
+        std::vector<link> below;
+        while (level.front()->type == NodeType::INTERNAL) {
+            keys.clear();
+            below.clear();
+            for (link current: level) {
+                InternalNode* internal{ static_cast<InternalNode*>(current) };
+                keys.insert(keys.end(), internal->values, internal->values + internal->size);
+                below.insert(below.end(), internal->children, internal->children + internal->size + 1);
+            }
+            if (keys.size() >= count) break;
+            level.swap(below);
+        }
+        if (keys.size() <= count) return keys;
+        std::vector<key_type> picked;
+        picked.reserve(count);
+        for (size_type i{ 1 }; i <= count; ++i) {
+            picked.push_back(keys[i * keys.size() / (count + 1)]);
+        }
+        return picked;
+    }
+
+    // combines lhs and rhs range by range with op(lhs_first, lhs_last, rhs_first, rhs_last, out), which has to
+    // append the sorted result for the two ranges to the vector out. the ranges are cut at index keys of the
+    // larger tree, each one streams both leaf chains. large inputs are spread over all hardware threads
+    template<typename Op>
+    static std::vector<key_type> combine(const ADS_set& lhs, const ADS_set& rhs, Op op) {
+        size_type threads{ 1 };
+        if (lhs.sz + rhs.sz >= parallel_threshold) threads = std::max<size_type>(std::thread::hardware_concurrency(), 1);
+        std::vector<key_type> cuts{ threads > 1 ? (lhs.sz >= rhs.sz ? lhs : rhs).splitters(threads * ranges_per_thread - 1)
+                                                : std::vector<key_type>{} };
+        size_type ranges{ cuts.size() + 1 };
+        std::vector<std::vector<key_type>> results(ranges);
+        std::vector<std::exception_ptr> errors(ranges);
+        std::atomic<size_type> next{ 0 };
+        auto work = [&] {
+            for (size_type i{ next.fetch_add(1) }; i < ranges; i = next.fetch_add(1)) {
+                try {
+                    const_iterator lhs_first{ i > 0 ? lhs.lower_bound(cuts[i - 1]) : lhs.begin() };
+                    const_iterator lhs_last{ i < cuts.size() ? lhs.lower_bound(cuts[i]) : lhs.end() };
+                    const_iterator rhs_first{ i > 0 ? rhs.lower_bound(cuts[i - 1]) : rhs.begin() };
+                    const_iterator rhs_last{ i < cuts.size() ? rhs.lower_bound(cuts[i]) : rhs.end() };
+                    op(lhs_first, lhs_last, rhs_first, rhs_last, results[i]);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (size_type t{ 1 }; t < std::min(threads, ranges); ++t) {
+            pool.emplace_back(work);
+        }
+        work();
+        for (std::thread& thread: pool) {
+            thread.join();
+        }
+        for (const std::exception_ptr& error: errors) {
+            if (error) std::rethrow_exception(error);
+        }
+
+        if (ranges == 1) return std::move(results.front());
+        size_type total{ 0 };
+        for (const std::vector<key_type>& result: results) {
+            total += result.size();
+        }
+        std::vector<key_type> keys;
+        keys.reserve(total);
+        for (std::vector<key_type>& result: results) {
+            std::move(result.begin(), result.end(), std::back_inserter(keys));
+        }
+        return keys;
+    }
+
+    static void unite(const_iterator l_first, const_iterator l_last, const_iterator r_first, const_iterator r_last, std::vector<key_type>& out) {
+        std::set_union(l_first, l_last, r_first, r_last, std::back_inserter(out), Node::cmp);
+    }
+
+    static void intersect(const_iterator l_first, const_iterator l_last, const_iterator r_first, const_iterator r_last, std::vector<key_type>& out) {
+        std::set_intersection(l_first, l_last, r_first, r_last, std::back_inserter(out), Node::cmp);
+    }
+
+    static void subtract(const_iterator l_first, const_iterator l_last, const_iterator r_first, const_iterator r_last, std::vector<key_type>& out) {
+        std::set_difference(l_first, l_last, r_first, r_last, std::back_inserter(out), Node::cmp);
+    }
+
+    // a set holding the sorted, unique keys, built bottom-up
+    ADS_set built_from(std::vector<key_type>&& keys) const {
+        ADS_set result{ get_allocator() };
+        result.replace_root(result.build_tree(std::make_move_iterator(keys.begin()), keys.size(), default_fill_factor), keys.size());
+        return result;
+    }
+
+    static void dump(link node, std::ostream& o, size_type level) {
+        if (level == 0) {
+            o << "[ROOT]";
+        } else {
+            o << '[' << level << ']';
+        }
+        o << " [";
+        switch (node->type) {
+            case NodeType::INTERNAL:
+                o << "INTERNAL";
+                break;
+            case NodeType::EXTERNAL:
+                o << "EXTERNAL";
+                break;
+        }
+        size_type capacity{ node->type == NodeType::INTERNAL ? InternalNode::M : ExternalNode::M };
+        o << " <" << node->size << "/" << capacity << "> (" << (node->size * 100.0) / capacity << "%)]";
+        if (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            for (size_type i{ 0 }; i < internal->size; ++i) {
+                o << " (" << i << ")" << internal->values[i];
+            }
+            for (size_type i{ 0 }; i <= internal->size; ++i) {
+                o << "\n\t" << i << ". ";
+                dump(internal->children[i], o, level + 1);
+            }
+        } else {
+            ExternalNode* external{ static_cast<ExternalNode*>(node) };
+            for (size_type i{ 0 }; i < external->size; ++i) {
+                o << " (" << i << ")" << external->values[i];
+            }
+        }
+    }
+
+public:
+    ADS_set() : ADS_set(Allocator()) {}
+
+    explicit ADS_set(const Allocator& alloc) : internal_pool{ alloc }, external_pool{ alloc }, root{ nullptr }, sz{ 0 } {
+        root = new_external();
+        TRACE_DEB("ADS_set constructed via default constructor")
+    }
+
+    ADS_set(std::initializer_list<key_type> ilist, const Allocator& alloc = Allocator())
+            : internal_pool{ alloc }, external_pool{ alloc }, root{ nullptr }, sz{ 0 } {
+        bulk_load(ilist.begin(), ilist.end());
+        TRACE_DEB("ADS_set constructed via i-list constructor")
+    }
+
+    template<typename InputIt>
+    ADS_set(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+            : internal_pool{ alloc }, external_pool{ alloc }, root{ nullptr }, sz{ 0 } {
+        bulk_load(first, last);
+        TRACE_DEB("ADS_set constructed via range constructor")
+    }
+
+    // the iterator of other already yields sorted, unique keys -> no need to check or sort
+    ADS_set(const ADS_set& other)
+            : internal_pool{ std::allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator()) },
+              external_pool{ internal_pool.get_allocator() },
+              root{ nullptr },
+              sz{ other.sz } {
+        root = build_tree(other.begin(), other.sz, default_fill_factor);
+        TRACE_DEB("ADS_set constructed via copy constructor")
+    }
+
+    // takes over the nodes of other, other is left empty without allocating
+    ADS_set(ADS_set&& other) noexcept
+            : internal_pool{ std::move(other.internal_pool) },
+              external_pool{ std::move(other.external_pool) },
+              snapshots{ std::move(other.snapshots) },
+              root{ other.root },
+              sz{ other.sz },
+              frozen{ std::move(other.frozen) } {
+        other.root = empty_root();
+        other.sz = 0;
+        other.tail = nullptr;
+        TRACE_DEB("ADS_set constructed via move constructor")
+    }
+
+    // nodes still shared with snapshots stay in the pools, which are handed over to the snapshots
+    ~ADS_set() {
+        TRACE_DEB("Deconstructing ADS_set")
+        release_all();
+        if (snapshots) {
+            snapshots->internal_pool.swap(internal_pool);
+            snapshots->external_pool.swap(external_pool);
+        }
+        sz = 0;
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const {
+        return internal_pool.get_allocator();
+    }
+
+    ADS_set& operator=(const ADS_set& other) {
+        if (this != &other) {
+            replace_root(build_tree(other.begin(), other.sz, default_fill_factor), other.sz);
+        }
+        return *this;
+    }
+
+    ADS_set& operator=(ADS_set&& other) noexcept {
+        if (this != &other) {
+            ADS_set moved{ std::move(other) };
+            swap(moved);
+        }
+        return *this;
+    }
+
+    ADS_set& operator=(std::initializer_list<key_type> ilist) {
+        bulk_load(ilist.begin(), ilist.end());
+        return *this;
+    }
+
+    // replaces the contents with the keys in [first, last), building the tree bottom-up:
+    // leaves are packed left to right at fill_factor * M keys, the index levels above are built in one pass each.
+    // sorted input is detected and used as is, everything else is copied and sorted first.
+    template<typename InputIt>
+    void bulk_load(InputIt first, InputIt last, double fill_factor = default_fill_factor) {
+        TRACE_DEB("Bulk loading ADS_set with fill factor " << fill_factor)
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr(std::is_base_of_v<std::forward_iterator_tag, category>) {
+            if (strictly_sorted(first, last)) {
+                size_type count{ static_cast<size_type>(std::distance(first, last)) };
+                replace_root(build_tree(first, count, fill_factor), count);
+                return;
+            }
+        }
+        std::vector<key_type> keys(first, last);
+        sort_unique(keys);
+        replace_root(build_tree(std::make_move_iterator(keys.begin()), keys.size(), fill_factor), keys.size());
+    }
+
+    [[nodiscard]] size_type size() const {
+        TRACE_DEB("Returning set size " << sz)
+        return sz;
+    }
+
+    [[nodiscard]] bool empty() const {
+        TRACE_DEB("ADS_set is" << (sz != 0 ? " not " : "") << "empty")
+        return sz == 0;
+    }
+
+    void insert(std::initializer_list<key_type> ilist) {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    std::pair<iterator, bool> insert(const key_type& key) {
+        return insert_unique(key);
+    }
+
+    std::pair<iterator, bool> insert(key_type&& key) {
+        return insert_unique(std::move(key));
+    }
+
+    // constructs the key in place from args, it is moved into its leaf afterwards
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert_unique(key_type(std::forward<Args>(args)...));
+    }
+
+    // insert with the leaf of hint as the first guess, which saves the descent if key belongs there (see
+    // hinted_leaf) and the leaf has room. end() stands for the last leaf, so appends may pass either.
+    // returns the iterator to key, whether it was inserted or already there
+    iterator insert(const_iterator hint, const key_type& key) {
+        return insert_unique(key, hint.current).first;
+    }
+
+    iterator insert(const_iterator hint, key_type&& key) {
+        return insert_unique(std::move(key), hint.current).first;
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        if (sz == 0) {
+            bulk_load(first, last);
+            return;
+        }
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr(std::is_base_of_v<std::forward_iterator_tag, category>) {
+            if (static_cast<size_type>(std::distance(first, last)) >= sz) { // merging and rebuilding is cheaper than descending per key
+                TRACE_DEB("Large range insert, merging and rebuilding")
+                std::vector<key_type> keys(first, last);
+                sort_unique(keys);
+                std::vector<key_type> merged;
+                merged.reserve(sz + keys.size());
+                std::set_union(begin(), end(), keys.cbegin(), keys.cend(), std::back_inserter(merged), Node::cmp);
+                replace_root(build_tree(std::make_move_iterator(merged.begin()), merged.size(), default_fill_factor), merged.size());
+                return;
+            }
+        }
+        if constexpr(std::is_base_of_v<std::forward_iterator_tag, category> && std::is_same_v<typename std::iterator_traits<InputIt>::value_type, key_type>) {
+            insert_batch(first, last);
+        } else {
+            for (InputIt it{ first }; it != last; ++it) {
+                insert(*it);
+            }
+        }
+    }
+
+    // releases the node arena as a whole instead of freeing node by node
+    void clear() {
+        TRACE_DEB("Clearing ADS_set")
+        release_all();
+        root = new_external();
+        sz = 0;
+    }
+
+    size_type erase(const key_type& key) {
+        return erase<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    size_type erase(const K& key) {
+        TRACE_INF("Erasing element: " << key)
+        TRACE_DEB("Size (prev): " << sz)
+        if (frozen) {
+            if (frozen_find(key) == sz) return 0;
+            thaw();
+        }
+
+        PathEntry path[max_height];
+        size_type depth;
+        ExternalNode* leaf{ find_leaf(key, path, depth) };
+        int pos{ leaf->findpos(key) };
+        if (pos < 0) {
+            TRACE_DEB("Erase ignored, element does not exist")
+            return 0;
+        }
+        leaf = unshare(path, depth, leaf);
+        leaf->erase_at(static_cast<size_type>(pos));
+        --sz;
+        count_path(path, depth, 1, false);
+
+        // merge upwards as long as the nodes on the path are temporarily invalid
+        if (depth > 0 && leaf->size < ExternalNode::min_size) {
+            rebalance<ExternalNode>(path, depth - 1);
+            for (--depth; depth > 0 && path[depth].node->size < InternalNode::min_size; --depth) {
+                rebalance<InternalNode>(path, depth - 1);
+            }
+        }
+        if (root->size == 0 && root->type == NodeType::INTERNAL) {
+            TRACE_DEB("Erase triggered root merge")
+            link old_root{ root };
+            root = static_cast<InternalNode*>(root)->children[0];
+            free_node(old_root);
+        }
+        return 1;
+    }
+
+    // inserts the keys in [first, last) and returns the number of inserted keys. the batch is walked alongside
+    // the tree: every run of keys falling into the same leaf costs one descent and is merged into the leaf as a
+    // whole, splits are resolved bottom-up afterwards. unsorted batches are copied and sorted first
+    template<typename ForwardIt>
+    size_type insert_batch(ForwardIt first, ForwardIt last) {
+        static_assert(std::is_same_v<typename std::iterator_traits<ForwardIt>::value_type, key_type>, "batch inserts need a range of key_type");
+        if (!std::is_sorted(first, last, Node::cmp)) {
+            std::vector<key_type> keys(first, last);
+            sort_unique(keys);
+            return insert_batch(keys.cbegin(), keys.cend());
+        }
+        if (frozen) { // stops at the first new key, which makes the thaw worth it
+            if (std::all_of(first, last, [this](const key_type& key) { return frozen_find(key) < sz; })) return 0;
+            thaw();
+        }
+        size_type prev_size{ sz };
+        if (sz == 0) {
+            bulk_load(first, last);
+            return sz;
+        }
+        TRACE_DEB("Batch insert, size (prev): " << sz)
+
+        PathEntry path[max_height];
+        std::vector<const key_type*> run;
+        std::vector<key_type> keys;
+        std::vector<link> links;
+        PendingChildren pending;
+        PendingChildren next_pending;
+        while (first != last) {
+            size_type depth;
+            ExternalNode* leaf{ find_leaf(*first, path, depth) };
+            const key_type* fence{ upper_fence(path, depth) };
+            run.clear();
+            for (; first != last && (!fence || Node::cmp(*first, *fence)); ++first) {
+                if (!run.empty() && !Node::cmp(*run.back(), *first)) continue; // duplicate within the batch
+                if (leaf->findpos(*first) >= 0) continue;
+                run.push_back(&*first);
+            }
+            if (run.empty()) continue;
+            leaf = unshare(path, depth, leaf);
+            sz += run.size();
+            count_path(path, depth, run.size(), true);
+
+            size_type total{ leaf->size + run.size() };
+            if (total <= ExternalNode::M) { // merge from the back, every key is moved at most once
+                size_type i{ leaf->size };
+                size_type j{ run.size() };
+                for (size_type pos{ total }; j > 0;) {
+                    if (i > 0 && Node::cmp(*run[j - 1], leaf->values[i - 1])) {
+                        leaf->values[--pos] = std::move(leaf->values[--i]);
+                    } else {
+                        leaf->values[--pos] = *run[--j];
+                    }
+                }
+                leaf->size = total;
+                continue;
+            }
+
+            keys.clear();
+            keys.reserve(total);
+            size_type i{ 0 };
+            for (const key_type* key : run) {
+                for (; i < leaf->size && Node::cmp(leaf->values[i], *key); ++i) {
+                    keys.push_back(std::move(leaf->values[i]));
+                }
+                keys.push_back(*key);
+            }
+            std::move(leaf->values + i, leaf->values + leaf->size, std::back_inserter(keys));
+            pending.clear();
+            distribute_leaf(leaf, keys, pending);
+
+            // split upwards as long as there are nodes to link in
+            while (!pending.empty()) {
+                if (depth == 0) {
+                    TRACE_DEB("Batch insert triggered root split")
+                    root = new_internal(&root, 0);
+                    insert_children(static_cast<InternalNode*>(root), 0, pending, next_pending, keys, links);
+                } else {
+                    PathEntry& parent{ path[--depth] };
+                    insert_children(parent.node, parent.childpos, pending, next_pending, keys, links);
+                }
+            }
+        }
+        return sz - prev_size;
+    }
+
+    // erases the keys in [first, last) and returns the number of erased keys. like insert_batch, every run of
+    // keys falling into the same leaf costs one descent and is removed in a single pass over the leaf
+    template<typename ForwardIt>
+    size_type erase_batch(ForwardIt first, ForwardIt last) {
+        static_assert(std::is_same_v<typename std::iterator_traits<ForwardIt>::value_type, key_type>, "batch erases need a range of key_type");
+        if (!std::is_sorted(first, last, Node::cmp)) {
+            std::vector<key_type> keys(first, last);
+            sort_unique(keys);
+            return erase_batch(keys.cbegin(), keys.cend());
+        }
+        if (frozen) {
+            if (std::none_of(first, last, [this](const key_type& key) { return frozen_find(key) < sz; })) return 0;
+            thaw();
+        }
+        size_type prev_size{ sz };
+        TRACE_DEB("Batch erase, size (prev): " << sz)
+
+        PathEntry path[max_height];
+        while (first != last && sz > 0) {
+            size_type depth;
+            ExternalNode* leaf{ find_leaf(*first, path, depth) };
+            leaf = unshare(path, depth, leaf); // the run is compacted in place before it is known whether it erases anything
+            const key_type* fence{ upper_fence(path, depth) };
+            size_type read{ 0 };
+            size_type write{ 0 };
+            for (; first != last && (!fence || Node::cmp(*first, *fence)); ++first) {
+                for (; read < leaf->size && Node::cmp(leaf->values[read], *first); ++read, ++write) {
+                    if (read != write) leaf->values[write] = std::move(leaf->values[read]);
+                }
+                if (read < leaf->size && !Node::cmp(*first, leaf->values[read])) ++read;
+            }
+            if (read == write) continue;
+            for (; read < leaf->size; ++read, ++write) {
+                leaf->values[write] = std::move(leaf->values[read]);
+            }
+            sz -= leaf->size - write;
+            count_path(path, depth, leaf->size - write, false);
+            leaf->size = write;
+
+            // merge upwards as long as the nodes on the path are temporarily invalid
+            if (depth > 0 && leaf->size < ExternalNode::min_size) {
+                rebalance<ExternalNode>(path, depth - 1);
+                for (--depth; depth > 0 && path[depth].node->size < InternalNode::min_size; --depth) {
+                    rebalance<InternalNode>(path, depth - 1);
+                }
+            }
+            if (root->size == 0 && root->type == NodeType::INTERNAL) {
+                TRACE_DEB("Batch erase triggered root merge")
+                link old_root{ root };
+                root = static_cast<InternalNode*>(root)->children[0];
+                free_node(old_root);
+            }
+        }
+        return prev_size - sz;
+    }
+
+    size_type count(const key_type& key) const {
+        return count<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    size_type count(const K& key) const {
+        TRACE_DEB("Counting element '" << key << '\'')
+        if (frozen) {
+            size_type position{ frozen_rank<false>(key) };
+            return position < sz && !Node::cmp(key, frozen_key(position)) ? 1 : 0;
+        }
+        return find_leaf(key)->findpos(key) >= 0 ? 1 : 0;
+    }
+
+    iterator find(const key_type& key) const {
+        return find<key_type>(key);
+    }
+
+    template<typename K, lookup_key<K> = 0>
+    iterator find(const K& key) const {
+        TRACE_DEB("Searching element '" << key << '\'')
+        if (frozen) {
+            size_type position{ frozen_rank<false>(key) };
+            return position < sz && !Node::cmp(key, frozen_key(position)) ? frozen_iterator(position) : Iterator();
+        }
+        ExternalNode* leaf{ find_leaf(key) };
+        int pos{ leaf->findpos(key) };
+        if (pos < 0) return Iterator(); // not found, end iterator returned
+        return Iterator(leaf, static_cast<size_type>(pos));
+    }
+
+    // looks up every key in [first, last) and writes its iterator (end() if missing) to out, in input order.
+    // the lookups of a batch overlap their cache misses, see lookup_many
+    template<typename ForwardIt, typename OutputIt>
+    OutputIt find_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+        lookup_many(first, last, [&out](ExternalNode* leaf, int pos) {
+            *out++ = pos < 0 ? Iterator() : Iterator(leaf, static_cast<size_type>(pos));
+        });
+        return out;
     }
 
-    ADS_set(std::initializer_list<key_type> ilist) : root{ new ExternalNode() }, sz{ 0 } {
-        for (const key_type& elem: ilist) {
-            insert(elem);
-        }
-        TRACE_DEB("ADS_set constructed via i-list constructor")
+    // like find_many, but writes whether each key is contained
+    template<typename ForwardIt, typename OutputIt>
+    OutputIt contains_many(ForwardIt first, ForwardIt last, OutputIt out) const {
+        lookup_many(first, last, [&out](ExternalNode*, int pos) {
+            *out++ = pos >= 0;
+        });
+        return out;
     }
 
-    template<typename InputIt>
-    ADS_set(InputIt first, InputIt last) : root{ new ExternalNode() }, sz{ 0 } {
-        for (InputIt it{ first }; it != last; ++it) {
-            insert(*it);
-        }
-        TRACE_DEB("ADS_set constructed via range constructor")
+    // first element not less than key
+    iterator lower_bound(const key_type& key) const {
+        return lower_bound<key_type>(key);
     }
 
-    ADS_set(const ADS_set& other) : ADS_set(other.begin(), other.end()) {}
+    template<typename K, lookup_key<K> = 0>
+    iterator lower_bound(const K& key) const {
+        if (frozen) return frozen_iterator(frozen_rank<false>(key));
+        ExternalNode* leaf{ find_leaf(key) };
+        return leaf_iterator(leaf, leaf->lower_pos(key));
+    }
 
-    ~ADS_set() {
-        TRACE_DEB("Deconstructing ADS_set")
-        delete root;
-        sz = 0;
+    // first element greater than key
+    iterator upper_bound(const key_type& key) const {
+        return upper_bound<key_type>(key);
     }
 
-    ADS_set& operator=(const ADS_set& other) {
-        clear();
-        insert(other.begin(), other.end());
-        return *this;
+    template<typename K, lookup_key<K> = 0>
+    iterator upper_bound(const K& key) const {
+        if (frozen) return frozen_iterator(frozen_rank<true>(key));
+        ExternalNode* leaf{ find_leaf(key) };
+        return leaf_iterator(leaf, leaf->upper_pos(key));
     }
 
-    ADS_set& operator=(std::initializer_list<key_type> ilist) {
-        clear();
-        insert(ilist.begin(), ilist.end());
-        return *this;
+    std::pair<iterator, iterator> equal_range(const key_type& key) const {
+        return equal_range<key_type>(key);
     }
 
-    [[nodiscard]] size_type size() const {
-        TRACE_DEB("Returning set size " << sz)
-        return sz;
+    template<typename K, lookup_key<K> = 0>
+    std::pair<iterator, iterator> equal_range(const K& key) const {
+        if (frozen) {
+            size_type position{ frozen_rank<false>(key) };
+            bool found{ position < sz && !Node::cmp(key, frozen_key(position)) };
+            return std::pair<iterator, iterator>(frozen_iterator(position), frozen_iterator(found ? position + 1 : position));
+        }
+        ExternalNode* leaf{ find_leaf(key) };
+        size_type pos{ leaf->lower_pos(key) };
+        bool found{ pos < leaf->size && !Node::cmp(key, leaf->values[pos]) };
+        return std::pair<iterator, iterator>(leaf_iterator(leaf, pos), leaf_iterator(leaf, found ? pos + 1 : pos));
     }
 
-    [[nodiscard]] bool empty() const {
-        TRACE_DEB("ADS_set is" << (sz != 0 ? " not " : "") << "empty")
-        return sz == 0;
+    // calls visitor with every element in [lo, hi) in ascending order, returns the number of visited elements.
+    // a visitor returning bool stops the scan by returning false. the scan descends once and then streams
+    // the leaf chain, prefetching the next leaf while the current one is visited. lo and hi are only ever
+    // compared with stored keys, never with each other (see count_range), hi <= lo visits nothing
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) const {
+        return for_each_in_range<key_type>(lo, hi, std::forward<Visitor>(visitor));
     }
 
-    void insert(std::initializer_list<key_type> ilist) {
-        for (const key_type& elem: ilist) {
-            insert(elem);
+    template<typename K, typename Visitor, lookup_key<K> = 0>
+    size_type for_each_in_range(const K& lo, const K& hi, Visitor&& visitor) const {
+        ExternalNode* leaf;
+        size_type pos;
+        if (frozen) {
+            Iterator first{ frozen_iterator(frozen_rank<false>(lo)) };
+            leaf = first.current;
+            pos = first.pos;
+        } else {
+            leaf = find_leaf(lo);
+            pos = leaf->lower_pos(lo);
+        }
+        size_type visited{ 0 };
+        while (leaf) {
+            if (leaf->next) ads_detail::prefetch(leaf->next, sizeof(ExternalNode));
+            bool last{ leaf->size > 0 && !Node::cmp(leaf->values[leaf->size - 1], hi) }; // range ends in this leaf
+            size_type stop{ last ? leaf->lower_pos(hi) : leaf->size };
+            for (; pos < stop; ++pos, ++visited) {
+                if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                    if (!visitor(static_cast<const key_type&>(leaf->values[pos]))) return visited + 1;
+                } else {
+                    visitor(static_cast<const key_type&>(leaf->values[pos]));
+                }
+            }
+            if (last) break;
+            leaf = leaf->next;
+            pos = 0;
         }
+        return visited;
     }
 
-    std::pair<iterator, bool> insert(const key_type& key) {
-        TRACE_INF("Inserting element: " << key)
-        TRACE_DEB("Size (prev): " << sz)
+    // number of elements less than key. O(log n) with ADS_SET_ORDER_STATS, which sums the counts left of the
+    // descent, and for frozen sets, otherwise the leaves before key are counted one by one
+    size_type rank(const key_type& key) const {
+        return rank<key_type>(key);
+    }
 
-        std::pair<iterator, InsertState> result{ root->add_elem(key) };
-        switch (result.second) {
-            case InsertState::SUCCESS: // size + 1, return true
-                TRACE_DEB("Insert successful at top level")
-                ++sz;
-                return std::pair<iterator, bool>(result.first, true);
-            case InsertState::EXISTS: // size + 0, return false
-                TRACE_DEB("Insert ignored, element exists already")
-                return std::pair<iterator, bool>(result.first, false);
-            case InsertState::TRIGGER_SPLIT: // split, size + 1, return true
-                TRACE_DEB("Insert triggered root split")
-                std::pair<link, const key_type*> splitres{ root->split() };
-                const key_type& new_index{ splitres.second ? *splitres.second : splitres.first->values[0] };
-                root = new InternalNode(new_index, root, splitres.first);
-                ++sz;
-                return std::pair(root->find(key), true);
-        }
-        TRACE_ERR("Should never reach this code path")
-        return {}; // unreachable
+    template<typename K, lookup_key<K> = 0>
+    size_type rank(const K& key) const {
+        if (frozen) return frozen_rank<false>(key);
+        size_type below{ 0 };
+#ifdef ADS_SET_ORDER_STATS
+        ADS_SET_COUNT(descents, 1)
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ internal->find_child_pos(key) };
+            for (size_type i{ 0 }; i < childpos; ++i) {
+                below += internal->counts[i];
+            }
+            node = internal->children[childpos];
+        }
+        return below + static_cast<ExternalNode*>(node)->lower_pos(key);
+#else
+        for (ExternalNode* leaf{ begin().current }; leaf; leaf = leaf->next) {
+            if (!Node::cmp(leaf->values[leaf->size - 1], key)) return below + leaf->lower_pos(key);
+            below += leaf->size;
+        }
+        return below;
+#endif
     }
 
-    template<typename InputIt>
-    void insert(InputIt first, InputIt last) {
-        for (InputIt it{ first }; it != last; ++it) {
-            insert(*it);
+    // iterator to the element with k smaller ones (k counts from 0), end() if k >= size(). the p-quantile is
+    // nth(p * (size() - 1)). O(log n) with ADS_SET_ORDER_STATS, O(1) for frozen sets, otherwise the leaves before
+    // it are skipped one by one
+    iterator nth(size_type k) const {
+        if (k >= sz) return Iterator();
+        if (frozen) return frozen_iterator(k);
+#ifdef ADS_SET_ORDER_STATS
+        ADS_SET_COUNT(descents, 1)
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            InternalNode* internal{ static_cast<InternalNode*>(node) };
+            size_type childpos{ 0 };
+            for (; k >= internal->counts[childpos]; ++childpos) {
+                k -= internal->counts[childpos];
+            }
+            node = internal->children[childpos];
+        }
+        return Iterator(static_cast<ExternalNode*>(node), k);
+#else
+        ExternalNode* leaf{ begin().current };
+        for (; k >= leaf->size; leaf = leaf->next) {
+            k -= leaf->size;
         }
+        return Iterator(leaf, k);
+#endif
     }
 
-    void clear() {
-        TRACE_DEB("Clearing ADS_set")
-        delete root;
-        root = new ExternalNode();
-        sz = 0;
+    // number of elements in [lo, hi). two rank descents with ADS_SET_ORDER_STATS and for frozen sets, otherwise
+    // the leaves of the range are counted without visiting their elements. like for_each_in_range, the bounds
+    // are compared with stored keys only: a transparent comparator need not order two lookup keys (raw
+    // const char* would compare as pointers), so hi <= lo is found by hi ranking no higher than lo
+    size_type count_range(const key_type& lo, const key_type& hi) const {
+        return count_range<key_type>(lo, hi);
     }
 
-    size_type erase(const key_type& key) {
-        TRACE_INF("Erasing element: " << key)
-        TRACE_DEB("Size (prev): " << sz)
-        EraseState result{ root->remove_elem(key) };
-
-        switch (result) {
-            case EraseState::SUCCESS: // size - 1, return 1
-                TRACE_DEB("Erase successful at top level")
-                --sz;
-                return 1;
-            case EraseState::NOT_FOUND: // size - 0, return 0
-                TRACE_DEB("Erase ignored, element does not exist")
-                return 0;
-            case EraseState::TRIGGER_MERGE: // ignore signal if nodesize > 0, size - 1, return 1
-                if (root->size == 0) {
-                    TRACE_DEB("Erase triggered root merge")
-                    if (root->type() == NodeType::INTERNAL) {
-                        std::pair<key_type*, link*> root_elems = root->get_all();
-                        delete root;
-                        root = root_elems.second[0];
-                        delete[] root_elems.first;
-                        delete[] root_elems.second;
-                    } else {
-                        delete root; // tree is now empty
-                        root = new ExternalNode();
-                    }
-                }
-                --sz;
-                return 1;
+    template<typename K, lookup_key<K> = 0>
+    size_type count_range(const K& lo, const K& hi) const {
+        if (frozen) {
+            size_type first{ frozen_rank<false>(lo) };
+            return std::max(frozen_rank<false>(hi), first) - first;
+        }
+#ifdef ADS_SET_ORDER_STATS
+        size_type first{ rank(lo) };
+        return std::max(rank(hi), first) - first;
+#else
+        ExternalNode* leaf{ find_leaf(lo) };
+        size_type pos{ leaf->lower_pos(lo) };
+        size_type keys{ 0 };
+        for (; leaf; leaf = leaf->next, pos = 0) {
+            if (leaf->size > 0 && !Node::cmp(leaf->values[leaf->size - 1], hi)) return keys + std::max(leaf->lower_pos(hi), pos) - pos;
+            keys += leaf->size - pos;
         }
-        TRACE_ERR("Should never reach this code path")
-        return 0; // unreachable
+        return keys;
+#endif
     }
 
-    size_type count(const key_type& key) const {
-        TRACE_DEB("Counting element '" << key << '\'')
-        return root->find(key) != end() ? 1 : 0;
+    // writes the set to path in the page format of ads_detail::PageLayout, which mapped_ADS_set opens without
+    // deserializing. the nodes are repacked into full pages, the fanout of this set does not matter.
+    // throws std::runtime_error if the file can not be written
+    void save(const std::string& path) const {
+        static_assert(std::is_trivially_copyable_v<key_type>, "only trivially copyable keys can be saved");
+        static_assert(std::is_same_v<key_compare, std::less<key_type>> || std::is_same_v<key_compare, std::less<>>,
+                      "mapped_ADS_set searches saved files with operator<");
+        ads_detail::PageLayout<key_type>::write(path, begin(), sz);
     }
 
-    iterator find(const key_type& key) const {
-        TRACE_DEB("Searching element '" << key << '\'')
-        return root->find(key);
+    // set algebra: both trees are streamed in order, range by range in parallel for large inputs (see combine),
+    // and the result is bulk loaded. O(n + m) instead of a descent per key
+    ADS_set set_union(const ADS_set& other) const {
+        return built_from(combine(*this, other, unite));
+    }
+
+    ADS_set set_intersection(const ADS_set& other) const {
+        return built_from(combine(*this, other, intersect));
+    }
+
+    // the keys of this set which are not in other
+    ADS_set set_difference(const ADS_set& other) const {
+        return built_from(combine(*this, other, subtract));
+    }
+
+    // takes over all keys of other, which is left empty
+    void merge(ADS_set&& other) {
+        if (this == &other || other.sz == 0) return;
+        std::vector<key_type> keys{ combine(*this, other, unite) };
+        replace_root(build_tree(std::make_move_iterator(keys.begin()), keys.size(), default_fill_factor), keys.size());
+        other.clear();
     }
 
     void swap(ADS_set& other) {
+        std::swap(tail, other.tail);
+        internal_pool.swap(other.internal_pool);
+        external_pool.swap(other.external_pool);
+        snapshots.swap(other.snapshots);
         std::swap(sz, other.sz);
         std::swap(root, other.root);
+        frozen.swap(other.frozen);
+    }
+
+    // compacts the set into a read-only layout for long read-mostly phases (see Frozen): the keys move into one
+    // array of leaves packed full, a pointer-free index of cache line sized nodes replaces the internal nodes.
+    // a lookup searches one node per level with the SIMD kernels and computes where to continue instead of
+    // loading a link, rank and nth take O(log n) and O(1). iteration is unchanged. the first write that changes the
+    // set thaws it again, which invalidates all iterators. inserting present and erasing absent keys is answered
+    // through the index and keeps the layout. O(n), no-op if the set is frozen already
+    void freeze() {
+        if (frozen) return;
+        TRACE_DEB("Freezing ADS_set of size " << sz)
+        std::unique_ptr<Frozen> layout{ std::make_unique<Frozen>((sz + frozen_fill - 1) / frozen_fill, get_allocator()) };
+        size_type position{ 0 };
+        for (Iterator it{ begin() }; it != end(); ++it, ++position) {
+            ExternalNode& leaf{ layout->leaves[position / frozen_fill] };
+            if (snapshots) {
+                leaf.values[leaf.size++] = *it; // the nodes may still be read through snapshots
+            } else {
+                leaf.values[leaf.size++] = std::move(it.current->values[it.pos]);
+            }
+        }
+        for (size_type i{ 1 }; i < layout->leaves.size(); ++i) {
+            layout->leaves[i - 1].next = &layout->leaves[i];
+        }
+
+        // index levels bottom-up, then laid out root first. all nodes but the last one of a level are full, so
+        // child c of a level whose children span keys each starts at key c * span
+        size_type span{ frozen_block };
+        for (size_type children{ (sz + frozen_block - 1) / frozen_block }; children > 1; children = (children + frozen_block) / (frozen_block + 1)) {
+            layout->levels.insert(layout->levels.begin(), typename Frozen::Level{ 0, children, span });
+            span *= frozen_block + 1;
+        }
+        size_type offset{ 0 };
+        for (typename Frozen::Level& level: layout->levels) {
+            level.offset = offset;
+            offset += (level.children + frozen_block) / (frozen_block + 1) * frozen_block;
+        }
+        layout->index.resize(offset);
+        for (const typename Frozen::Level& level: layout->levels) {
+            for (size_type c{ 1 }; c < level.children; ++c) {
+                if (c % (frozen_block + 1) == 0) continue; // first child of a node, no separator before it
+                size_type key{ c * level.span };
+                layout->index[level.offset + c / (frozen_block + 1) * frozen_block + c % (frozen_block + 1) - 1] =
+                        layout->leaves[key / frozen_fill].values[key % frozen_fill];
+            }
+        }
+
+        release_all();
+        root = empty_root();
+        frozen = std::move(layout);
+    }
+
+    // rebuilds the tree of a frozen set from its keys, packed full like a bulk load. no-op if the set is not frozen
+    void thaw() {
+        if (!frozen) return;
+        TRACE_DEB("Thawing ADS_set of size " << sz)
+        replace_root(build_tree(begin(), sz, default_fill_factor), sz);
+    }
+
+    [[nodiscard]] bool is_frozen() const {
+        return frozen != nullptr;
+    }
+
+    // an immutable view of the current contents in O(1): the snapshot shares the tree, the set copies the nodes
+    // on the path of every later write that are still shared (path copying), so the snapshot never changes.
+    // taking a snapshot is a write to the set and needs the same synchronization, reading from a snapshot needs
+    // none, also while the set is written or after it is gone. a frozen set is thawed first
+    Snapshot snapshot() {
+        thaw();
+        if (!snapshots) snapshots = std::allocate_shared<SnapshotState>(get_allocator(), get_allocator());
+        if (root == empty_root()) root = new_external();
+        return Snapshot(snapshots, root, sz);
     }
 
     const_iterator begin() const {
-        return root->begin_it();
+        if (frozen) return frozen_iterator(0);
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            node = static_cast<InternalNode*>(node)->children[0];
+        }
+        if (node->size == 0) return Iterator(); // end iterator
+        return Iterator(static_cast<ExternalNode*>(node), 0);
     }
 
     const_iterator end() const {
         return Iterator();
     }
 
+    // shape and memory of the tree plus the operation counters, without printing a single key. visits every
+    // node once (leaves only for their size), O(number of nodes)
+    Stats stats() const {
+        Stats result;
+        result.size = sz;
+        if (frozen) {
+            frozen_stats(result);
+            return result;
+        }
+        std::vector<link> level{ root };
+        std::vector<link> below;
+        while (!level.empty()) {
+            bool leaves{ level.front()->type == NodeType::EXTERNAL };
+            ads_detail::LevelStats& current{ result.levels.emplace_back() };
+            current.capacity = leaves ? ExternalNode::M : InternalNode::M;
+            below.clear();
+            for (link node: level) {
+                ++current.nodes;
+                current.keys += node->size;
+                ++current.fill[std::min<size_type>(current.fill.size() - 1, node->size * current.fill.size() / current.capacity)];
+                if (!leaves) {
+                    InternalNode* internal{ static_cast<InternalNode*>(node) };
+                    below.insert(below.end(), internal->children, internal->children + internal->size + 1);
+                }
+            }
+            (leaves ? result.external_nodes : result.internal_nodes) += current.nodes;
+            level.swap(below);
+        }
+        result.height = result.levels.size() - 1;
+        result.bytes_allocated = internal_pool.capacity_bytes() + external_pool.capacity_bytes();
+        result.bytes_per_key = sz ? static_cast<double>(result.bytes_allocated) / static_cast<double>(sz) : 0.0;
+#ifdef ADS_SET_STATS
+        result.ops = counters.load();
+#endif
+        return result;
+    }
+
+    // sets the operation counters back to 0, no-op without ADS_SET_STATS
+    void reset_counters() {
+#ifdef ADS_SET_STATS
+        counters.reset();
+#endif
+    }
+
     void dump(std::ostream& o = std::cerr) const {
-        o << "B+ TREE: ADS_set<" << typeid(key_type).name() << ", " << N << ">, size: " << sz << std::endl;
+        o << "B+ TREE: ADS_set<" << typeid(key_type).name() << ", " << N << ">, size: " << sz
+          << ", capacities: " << internal_capacity << " (internal) / " << leaf_capacity << " (external)" << std::endl;
         o << "Sorted elements:";
         for (iterator it{ begin() }; it != end(); ++it) {
             o << ' ' << *it;
         }
         o << std::endl << "Structure:" << std::endl;
-        root->dump(o, 0);
+        if (frozen) {
+            o << "[FROZEN] " << frozen->levels.size() << " index level(s) of " << frozen_block << " keys per node, "
+              << frozen->leaves.size() << " leaves of " << frozen_fill << " keys";
+        } else {
+            dump(root, o, 0);
+        }
         o << std::endl;
     }
 
     bool operator==(const ADS_set& rhs) const {
         if (sz != rhs.sz) return false;
         for (const_iterator itl{ begin() }, itr{ rhs.begin() }; itl != end(); ++itl, ++itr) {
-            if (!eq(*itl, *itr)) return false;
+            if (Node::cmp(*itl, *itr) || Node::cmp(*itr, *itl)) return false;
         }
         return true;
     }
@@ -250,8 +2615,13 @@ public:
     }
 };
 
-template<typename Key, size_t N>
-class ADS_set<Key, N>::Iterator {
+// a forward iterator has to return a real reference into the container. where there is none to return
+// (ADS_packed_set, ADS_map, ADS_buffered_set) the iterator is declared an input iterator, which is only the
+// letter of the standard: its copies can be traversed again like those of a forward one
+template<typename Key, size_t N, typename Allocator, typename Compare>
+class ADS_set<Key, N, Allocator, Compare>::Iterator {
+    friend class ADS_set; // hinted inserts and frozen range scans start at current
+
 public:
     using value_type = Key;
     using difference_type = std::ptrdiff_t;
@@ -303,397 +2673,456 @@ public:
     }
 };
 
-template<typename Key, size_t N>
-struct ADS_set<Key, N>::Node {
-    static constexpr size_type M{ N * 2 }; // max size
-    static constexpr std::less<key_type> cmp = key_compare{};
-    key_type* values;
-    size_type size;
+// a snapshot owns its root, everything below is kept alive by the counts of the nodes. the last owner of a root
+// hands it back to the set through the shared state, it is freed with the next allocation of the set
+template<typename Key, size_t N, typename Allocator, typename Compare>
+class ADS_set<Key, N, Allocator, Compare>::Snapshot {
+public:
+    using value_type = Key;
+    using key_type = Key;
+    using size_type = typename ADS_set::size_type;
+    using const_iterator = SnapshotIterator;
+    using iterator = const_iterator;
 
-    // returns i if found at position i, or -(i + 1) if insertion should happen at i
-    int findpos(const key_type& elem) {
-        if (size == 0 || cmp(elem, values[0])) return -1;
-        for (size_type i{ 1 }; i < size; ++i) {
-            if (cmp(elem, values[i])) return cmp(values[i - 1], elem) ? invert(static_cast<int>(i)) : i - 1; // + / 0 for found, - for insertion point
-        }
-        return !cmp(values[size - 1], elem) ? size - 1 : invert(size);
-    }
+private:
+    std::shared_ptr<SnapshotState> state;
+    link root;
+    size_type sz;
 
-    inline size_type findpos_autoinvert(const key_type& elem) {
-        int pos{ findpos(elem) };
-        return pos < 0 ? invert(pos) : pos;
+public:
+    explicit Snapshot(std::shared_ptr<SnapshotState> _state, link _root, size_type _sz)
+            : state{ std::move(_state) }, root{ _root }, sz{ _sz } {
+        root->refs.fetch_add(1, std::memory_order_relaxed);
     }
 
-    // not safe if size >= N + 1
-    virtual void insert_at(const key_type& elem, size_type ins) {
-        for (size_type i{ size }; i > ins; --i) {
-            values[i] = values[i - 1];
-        }
-        values[ins] = elem;
-        ++size;
+    Snapshot(const Snapshot& other) : state{ other.state }, root{ other.root }, sz{ other.sz } {
+        root->refs.fetch_add(1, std::memory_order_relaxed);
     }
 
-    virtual void erase_at(size_type at) {
-        for (size_type i{ at }; i < size - 1; ++i) {
-            values[i] = values[i + 1];
-        }
-        --size;
+    Snapshot& operator=(Snapshot other) {
+        state.swap(other.state);
+        std::swap(root, other.root);
+        std::swap(sz, other.sz);
+        return *this;
     }
 
-    // temporary invalid nodes require + 1
-    explicit Node(size_type _size = 0) : values{ new key_type[M + 1] }, size{ _size } {}
-
-    Node(const key_type* _values, size_type _size) : values{ new key_type[M + 1] }, size{ _size } {
-        for (size_type i{ 0 }; i < _size; ++i) {
-            values[i] = _values[i];
-        }
+    ~Snapshot() {
+        if (root->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) state->retire(root);
     }
 
-    virtual NodeType type() = 0;
-
-    virtual iterator begin_it() = 0;
-
-    virtual iterator find(const key_type& elem) = 0;
-
-    virtual std::pair<iterator, InsertState> add_elem(const key_type& elem) = 0;
-
-    virtual EraseState remove_elem(const key_type& elem) = 0;
-
-    virtual std::pair<link, const key_type*> split(size_type split_at) = 0;
+    [[nodiscard]] size_type size() const {
+        return sz;
+    }
 
-    std::pair<link, const key_type*> split() {
-        return split((size - 1) / 2); // size to index conversion
+    [[nodiscard]] bool empty() const {
+        return sz == 0;
     }
 
-    virtual std::pair<key_type*, link*> get_all() = 0;
+    size_type count(const key_type& key) const {
+        return find_leaf(root, key)->findpos(key) >= 0 ? 1 : 0;
+    }
 
-    virtual void prepare_merge(const key_type& pulled_down) = 0;
+    const_iterator find(const key_type& key) const {
+        ExternalNode* leaf{ find_leaf(root, key) };
+        int pos{ leaf->findpos(key) };
+        if (pos < 0) return SnapshotIterator();
+        return SnapshotIterator(root, leaf, static_cast<size_type>(pos));
+    }
 
-    virtual void merge(link neighbour) = 0;
+    const_iterator lower_bound(const key_type& key) const {
+        ExternalNode* leaf{ find_leaf(root, key) };
+        size_type pos{ leaf->lower_pos(key) };
+        if (pos < leaf->size) return SnapshotIterator(root, leaf, pos);
+        return SnapshotIterator(root, pos > 0 ? next_leaf(root, leaf->values[pos - 1]) : nullptr, 0);
+    }
 
-    virtual void dump(std::ostream& o, size_type level) {
-        if (level == 0) {
-            o << "[ROOT]";
-        } else {
-            o << '[' << level << ']';
-        }
-        o << " [";
-        switch (type()) {
-            case NodeType::INTERNAL:
-                o << "INTERNAL";
-                break;
-            case NodeType::EXTERNAL:
-                o << "EXTERNAL";
-                break;
+    // like ADS_set::for_each_in_range
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) const {
+        size_type visited{ 0 };
+        for (const_iterator it{ lower_bound(lo) }; it != end() && Node::cmp(*it, hi); ++it) {
+            ++visited;
+            if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                if (!visitor(*it)) break;
+            } else {
+                visitor(*it);
+            }
         }
-        o << " <" << this->size << "/" << Node::M << "> (" << (this->size * 100.0) / Node::M << "%)]";
-        for (size_type i{ 0 }; i < this->size; ++i) {
-            o << " (" << i << ")" << this->values[i];
+        return visited;
+    }
+
+    const_iterator begin() const {
+        link node{ root };
+        while (node->type == NodeType::INTERNAL) {
+            node = static_cast<InternalNode*>(node)->children[0];
         }
+        if (node->size == 0) return SnapshotIterator();
+        return SnapshotIterator(root, static_cast<ExternalNode*>(node), 0);
     }
 
-    virtual ~Node() {
-        delete[] values;
+    const_iterator end() const {
+        return SnapshotIterator();
     }
 };
 
-template<typename Key, size_t N>
-struct ADS_set<Key, N>::InternalNode : public Node {
-    link* children;
-    bool ownership;
+// iterates below a snapshot root, the next leaf is found by a descent for the last key of the current one
+template<typename Key, size_t N, typename Allocator, typename Compare>
+class ADS_set<Key, N, Allocator, Compare>::SnapshotIterator {
+public:
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using iterator_category = std::forward_iterator_tag;
 
-    // temporary invalid nodes require + 2
-    InternalNode() : Node(), children{ new link[Node::M + 2] }, ownership{ true } {
-        children[0] = new ExternalNode();
-    }
+private:
+    link root;
+    ExternalNode* current;
+    size_type pos;
 
-    InternalNode(const key_type* _values, const link* _children, size_type _size)
-            : Node(_values, _size),
-              children{ new link[Node::M + 2] },
-              ownership{ true } {
-        for (size_type i{ 0 }; i <= _size; ++i) {
-            children[i] = _children[i];
-        }
-    }
+public:
+    SnapshotIterator() : root{ nullptr }, current{ nullptr }, pos{ 0 } {}
 
-    InternalNode(const key_type& value, link left, link right) : Node(1), children{ new link[Node::M + 2] }, ownership{ true } {
-        this->values[0] = value;
-        children[0] = left;
-        children[1] = right;
-    }
+    explicit SnapshotIterator(link _root, ExternalNode* _current, size_type _pos) : root{ _root }, current{ _current }, pos{ _pos } {}
 
-    inline size_type find_child_pos(const key_type& elem) {
-        int pos{ this->findpos(elem) };
-        return static_cast<size_type>(pos < -1 ? invert(pos) : (pos + 1));
+    reference operator*() const {
+        return current->values[pos];
     }
 
-    void insert_at(const key_type& elem, size_type ins) override {
-        for (size_type i{ this->size }; i > ins; --i) {
-            this->values[i] = this->values[i - 1];
-            this->children[i + 1] = this->children[i];
-        }
-        this->values[ins] = elem;
-        ++this->size;
+    pointer operator->() const {
+        return current->values + pos;
     }
 
-    void erase_at(size_type at) override {
-        delete children[at + 1]; // ownership should have been transferred
-        for (size_type i{ at }; i < this->size - 1; ++i) {
-            this->values[i] = this->values[i + 1];
-            this->children[i + 1] = this->children[i + 2];
+    SnapshotIterator& operator++() {
+        if (current) {
+            if (pos + 1 == current->size) {
+                current = next_leaf(root, current->values[pos]);
+                pos = 0;
+            } else {
+                ++pos;
+            }
         }
-        --this->size;
+        return *this;
     }
 
-    NodeType type() override {
-        return NodeType::INTERNAL;
+    SnapshotIterator operator++(int) {
+        SnapshotIterator old{ *this };
+        this->operator++();
+        return old;
     }
 
-    iterator begin_it() override {
-        return children[0]->begin_it();
+    bool operator==(const SnapshotIterator& rhs) const {
+        return current == rhs.current && pos == rhs.pos;
     }
 
-    iterator find(const key_type& elem) override {
-        size_type childpos{ find_child_pos(elem) };
-        return children[childpos]->find(elem);
+    bool operator!=(const SnapshotIterator& rhs) const {
+        return current != rhs.current || pos != rhs.pos;
     }
+};
 
-    std::pair<iterator, InsertState> add_elem(const key_type& elem) override {
-        size_type childpos{ find_child_pos(elem) };
-
-        std::pair<iterator, InsertState> result{ children[childpos]->add_elem(elem) };
-        if (result.second == InsertState::TRIGGER_SPLIT) { // split has to happen
-            std::pair<link, const key_type*> splitres{ children[childpos]->split() };
-            const key_type& new_index{ splitres.second ? *splitres.second : splitres.first->values[0] };
-            size_type new_pos{ this->findpos_autoinvert(new_index) };
+// nodes are plain tagged structs with their keys (and children) stored inline, so a node is a single
+// cache line aligned allocation. all dispatch on the node type happens statically in ADS_set
+template<typename Key, size_t N, typename Allocator, typename Compare>
+struct alignas(ads_detail::cache_line_size) ADS_set<Key, N, Allocator, Compare>::Node {
+    static constexpr key_compare cmp{};
+    // arithmetic keys in ascending order are searched with ads_detail::sorted_rank instead of the linear scan
+    static constexpr bool arithmetic_search{ std::is_arithmetic_v<key_type> && (std::is_same_v<key_compare, std::less<key_type>> || std::is_same_v<key_compare, std::less<>>) };
+    NodeType type;
+    std::atomic<unsigned> refs{ 1 }; // owners, see ADS_set::shared
+    size_type size;
 
-            this->insert_at(new_index, new_pos);
-            children[new_pos + 1] = splitres.first;
+    Node(NodeType _type, size_type _size) : type{ _type }, size{ _size } {}
+};
 
-            return std::pair<iterator, InsertState>(
-                    find(elem),
-                    this->size <= Node::M ? InsertState::SUCCESS : InsertState::TRIGGER_SPLIT // trigger split in parent if temporarily invalid
-            );
-        }
-        return result; // was successfully added to child node (or already existed)
-    }
+// key array and key operations shared by both node types, which may differ in capacity
+template<typename Key, size_t N, typename Allocator, typename Compare>
+template<size_t Capacity>
+struct ADS_set<Key, N, Allocator, Compare>::KeyNode : public Node {
+    static constexpr size_type M{ Capacity }; // max size
+    static constexpr size_type min_size{ Capacity / 2 };
+    key_type values[M + 1]; // temporary invalid nodes require + 1
 
-    EraseState remove_elem(const key_type& elem) override {
-        size_type childpos{ find_child_pos(elem) };
+    KeyNode(NodeType _type, size_type _size) : Node(_type, _size) {}
 
-        EraseState result{ children[childpos]->remove_elem(elem) };
-        if (result == EraseState::TRIGGER_MERGE) {
-            if constexpr(N > 1) {
-                childpos = childpos < 1 ? 1 : childpos;
-                key_type& id = this->values[childpos - 1];
-                link left{ children[childpos - 1] };
-                link right{ children[childpos] };
-                size_type totalsize{ left->size + right->size + (right->type() == NodeType::INTERNAL ? 1 : 0) };
-                if (totalsize > Node::M) { // split (rebalance) if greater than M (including pulled-down index key -> + 1)
-                    size_type split_at{ (totalsize - 1) / 2 }; // size to index conversion
-                    std::pair<link, const key_type*> splitres;
-                    if (split_at < left->size) { // split left, merge right into split result, split result is new right
-                        splitres = left->split(split_at);
-                        splitres.first->prepare_merge(id);
-                        splitres.first->merge(right);
-                    } else { // split right, merge right into left, split result is new right
-                        splitres = right->split(split_at - left->size);
-                        left->prepare_merge(id);
-                        left->merge(right);
-                    }
-                    key_type new_index{ splitres.second ? *splitres.second : splitres.first->values[0] };
-                    delete children[childpos]; // ownership should have been transferred
-                    children[childpos] = splitres.first;
-                    id = new_index;
-                } else { // transport all elements from right to left
-                    left->prepare_merge(id);
-                    left->merge(right); // pull from right, append to left
-
-                    this->erase_at(childpos - 1);
-                }
-            } else {
-                if (childpos == 0) {
-                    ++childpos;
-                }
+    // number of keys a bulk loaded node is filled with
+    static size_type fill(double fill_factor) {
+        return std::clamp<size_type>(static_cast<size_type>(fill_factor * M + 0.5), min_size, M);
+    }
 
-                children[childpos - 1]->prepare_merge(this->values[childpos - 1]);
-                children[childpos - 1]->merge(children[childpos]);
-                if (children[childpos - 1]->size > Node::M) { // internal node + two on the left
-                    std::pair<link, const key_type*> splitres{ children[childpos - 1]->split(1) };
-                    delete children[childpos];
-                    children[childpos] = splitres.first;
-                    this->values[childpos - 1] = splitres.second ? *splitres.second : splitres.first->values[0];
-                } else { // external node or internal node with one on the left
-                    this->erase_at(childpos - 1);
-                }
+    // the kernels of sorted_rank only apply to probes of key_type itself
+    template<typename K>
+    static constexpr bool kernel_search{ Node::arithmetic_search && std::is_same_v<K, key_type> };
+
+    // returns i if found at position i, or -(i + 1) if insertion should happen at i.
+    // elem is a key_type, or any type the comparator is transparent for
+    template<typename K>
+    int findpos(const K& elem) const {
+        if constexpr(kernel_search<K>) {
+            size_type lower{ ads_detail::sorted_rank<false>(values, this->size, elem) };
+            return lower < this->size && !Node::cmp(elem, values[lower]) ? static_cast<int>(lower) : invert(static_cast<int>(lower));
+        } else {
+            if (this->size == 0 || Node::cmp(elem, values[0])) return -1;
+            for (size_type i{ 1 }; i < this->size; ++i) {
+                if (Node::cmp(elem, values[i])) return Node::cmp(values[i - 1], elem) ? invert(static_cast<int>(i)) : i - 1; // + / 0 for found, - for insertion point
             }
-            return this->size >= N ? EraseState::SUCCESS : EraseState::TRIGGER_MERGE; // trigger merge in parent if temporarily invalid
+            return !Node::cmp(values[this->size - 1], elem) ? this->size - 1 : invert(this->size);
         }
+    }
 
-        return result; // was successfully deleted from child node (or not found)
+    // number of keys less than elem
+    template<typename K>
+    size_type lower_pos(const K& elem) const {
+        if constexpr(kernel_search<K>) {
+            return ads_detail::sorted_rank<false>(values, this->size, elem);
+        } else {
+            int pos{ findpos(elem) };
+            return static_cast<size_type>(pos < 0 ? invert(pos) : pos);
+        }
     }
 
-    std::pair<link, const key_type*> split(size_type split_at) override {
-        // construct arrays for right node
-        key_type right[Node::M + 1];
-        link right_children[Node::M + 2];
-        size_type right_size{ this->size - split_at - 1 };
-        for (size_type i{ 0 }; i < right_size; ++i) {
-            right[i] = this->values[split_at + 1 + i];
-            right_children[i] = children[split_at + 1 + i];
+    // number of keys not greater than elem
+    template<typename K>
+    size_type upper_pos(const K& elem) const {
+        if constexpr(kernel_search<K>) {
+            return ads_detail::sorted_rank<true>(values, this->size, elem);
+        } else {
+            int pos{ findpos(elem) };
+            return static_cast<size_type>(pos < 0 ? invert(pos) : pos + 1);
         }
-        right_children[right_size] = children[this->size];
+    }
 
-        // cut array for left node (this)
-        this->size = split_at;
+    // not safe if size >= M + 1
+    template<typename K>
+    void insert_at(K&& elem, size_type ins) {
+        std::move_backward(values + ins, values + this->size, values + this->size + 1);
+        values[ins] = std::forward<K>(elem);
+        ++this->size;
+    }
 
-        // construct pair to return
-        return std::pair<link, key_type*>(new InternalNode(right, right_children, right_size), this->values + split_at);
+    void erase_at(size_type at) {
+        std::move(values + at + 1, values + this->size, values + at);
+        --this->size;
     }
+};
 
-    std::pair<key_type*, link*> get_all() override {
-        key_type* vals = new key_type[this->size];
-        link* links = new link[this->size + 1];
-        for (size_type i{ 0 }; i < this->size; ++i) {
-            vals[i] = this->values[i];
-            links[i] = children[i];
+template<typename Key, size_t N, typename Allocator, typename Compare>
+struct ADS_set<Key, N, Allocator, Compare>::InternalNode : public KeyNode<internal_capacity> {
+    link children[InternalNode::M + 2]; // temporary invalid nodes require + 2
+#ifdef ADS_SET_ORDER_STATS
+    size_type counts[InternalNode::M + 2]; // keys below each child, moved along with the children
+#endif
+
+    // values have to be filled in by the caller
+    InternalNode(const link* _children, size_type _size) : KeyNode<internal_capacity>(NodeType::INTERNAL, _size) {
+        for (size_type i{ 0 }; i <= _size; ++i) {
+            children[i] = _children[i];
         }
-        links[this->size] = children[this->size];
-        ownership = false; // values are now owned by calling node
+        recount(0, _size);
+    }
 
-        return std::pair<key_type*, link*>(vals, links);
+    InternalNode(key_type&& value, link left, link right) : KeyNode<internal_capacity>(NodeType::INTERNAL, 1) {
+        this->values[0] = std::move(value);
+        children[0] = left;
+        children[1] = right;
+        recount(0, 1);
     }
 
-    void prepare_merge(const key_type& pulled_down) override {
-        this->values[this->size] = pulled_down;
-        ++this->size;
+    // copy sharing the children of other
+    explicit InternalNode(const InternalNode& other) : KeyNode<internal_capacity>(NodeType::INTERNAL, other.size) {
+        std::copy(other.values, other.values + other.size, this->values);
+        std::copy(other.children, other.children + other.size + 1, children);
+#ifdef ADS_SET_ORDER_STATS
+        std::copy(other.counts, other.counts + other.size + 1, counts);
+#endif
     }
 
-    void merge(link neighbour) override {
-        std::pair<key_type*, link*> elems{ neighbour->get_all() };
-        size_type prev_size{ this->size };
-        for (size_type i{ 0 }; i < neighbour->size; ++i) {
-            children[i + prev_size] = elems.second[i];
-            this->values[i + prev_size] = elems.first[i];
+    // recomputes the counts of the children in [first, last] from the children themselves, no-op without
+    // ADS_SET_ORDER_STATS
+    void recount([[maybe_unused]] size_type first, [[maybe_unused]] size_type last) {
+#ifdef ADS_SET_ORDER_STATS
+        for (; first <= last; ++first) {
+            counts[first] = subtree_size(children[first]);
         }
-        this->size += neighbour->size;
-        children[this->size] = elems.second[neighbour->size];
-
-        delete[] elems.first;
-        delete[] elems.second;
+#endif
     }
 
-    void dump(std::ostream& o, size_type level) override {
-        Node::dump(o, level);
+#ifdef ADS_SET_ORDER_STATS
+    size_type total() const {
+        size_type keys{ 0 };
         for (size_type i{ 0 }; i <= this->size; ++i) {
-            o << "\n\t" << i << ". ";
-            children[i]->dump(o, level + 1);
+            keys += counts[i];
         }
+        return keys;
     }
+#endif
 
-    ~InternalNode() override {
-        if (ownership) {
-            for (size_type i{ 0 }; i <= this->size; ++i) {
-                delete children[i];
-            }
-        }
-        delete[] children;
+    template<typename K>
+    size_type find_child_pos(const K& elem) const {
+        return this->upper_pos(elem); // keys equal to a separator live right of it
     }
-};
 
-template<typename Key, size_t N>
-struct ADS_set<Key, N>::ExternalNode : public Node {
-    ExternalNode* next;
+    // inserts elem at ins, the child right of it has to be set by the caller
+    template<typename K>
+    void insert_at(K&& elem, size_type ins) {
+        std::move_backward(this->values + ins, this->values + this->size, this->values + this->size + 1);
+        std::copy_backward(children + ins + 1, children + this->size + 1, children + this->size + 2);
+#ifdef ADS_SET_ORDER_STATS
+        std::copy_backward(counts + ins + 1, counts + this->size + 1, counts + this->size + 2);
+#endif
+        this->values[ins] = std::forward<K>(elem);
+        ++this->size;
+    }
 
-    ExternalNode() : Node(), next{ nullptr } {}
+    // erases the key at and the child right of at, the child has to be freed by the caller
+    void erase_at(size_type at) {
+        std::move(this->values + at + 1, this->values + this->size, this->values + at);
+        std::copy(children + at + 2, children + this->size + 1, children + at + 1);
+#ifdef ADS_SET_ORDER_STATS
+        std::copy(counts + at + 2, counts + this->size + 1, counts + at + 1);
+#endif
+        --this->size;
+    }
 
-    ExternalNode(const key_type* _values, size_type _size, ExternalNode* _next = nullptr) : Node(_values, _size), next{ _next } {}
+    // right already holds the children after split_at, returns the index key for the parent
+    key_type* split(size_type split_at, InternalNode* right) {
+        std::move(this->values + split_at + 1, this->values + split_at + 1 + right->size, right->values);
 
-    NodeType type() override {
-        return NodeType::EXTERNAL;
+        // cut array for left node (this), the index key stays in place until the parent has copied it
+        this->size = split_at;
+        return this->values + split_at;
     }
 
-    iterator begin_it() override {
-        if (this->size == 0) return Iterator(); // end iterator
-        return Iterator(this, 0);
+    // rotates the last count children of left (the left neighbour) and their keys through separator into the
+    // front of this node
+    void borrow_left(key_type& separator, InternalNode* left, size_type count) {
+        std::move_backward(this->values, this->values + this->size, this->values + this->size + count);
+        std::copy_backward(children, children + this->size + 1, children + this->size + 1 + count);
+        this->values[count - 1] = std::move(separator);
+        std::move(left->values + left->size - count + 1, left->values + left->size, this->values);
+        std::copy(left->children + left->size - count + 1, left->children + left->size + 1, children);
+#ifdef ADS_SET_ORDER_STATS
+        std::copy_backward(counts, counts + this->size + 1, counts + this->size + 1 + count);
+        std::copy(left->counts + left->size - count + 1, left->counts + left->size + 1, counts);
+#endif
+        separator = std::move(left->values[left->size - count]);
+        left->size -= count;
+        this->size += count;
     }
 
-    iterator find(const key_type& elem) override {
-        int pos{ this->findpos(elem) };
-        if (pos < 0) return Iterator(); // not found, end iterator returned
-        return Iterator(this, pos);
+    // rotates the first count children of right (the right neighbour) and their keys through separator onto
+    // the end of this node
+    void borrow_right(key_type& separator, InternalNode* right, size_type count) {
+        this->values[this->size] = std::move(separator);
+        std::move(right->values, right->values + count - 1, this->values + this->size + 1);
+        std::copy(right->children, right->children + count, children + this->size + 1);
+        separator = std::move(right->values[count - 1]);
+        std::move(right->values + count, right->values + right->size, right->values);
+        std::copy(right->children + count, right->children + right->size + 1, right->children);
+#ifdef ADS_SET_ORDER_STATS
+        std::copy(right->counts, right->counts + count, counts + this->size + 1);
+        std::copy(right->counts + count, right->counts + right->size + 1, right->counts);
+#endif
+        right->size -= count;
+        this->size += count;
     }
 
-    std::pair<iterator, InsertState> add_elem(const key_type& elem) override {
-        int pos{ this->findpos(elem) };
-        if (pos >= 0) return std::pair<iterator, InsertState>(Iterator(this, pos), InsertState::EXISTS); // ignore existing
-        size_type inv_pos{ static_cast<size_type>(invert(pos)) };
-        this->insert_at(elem, inv_pos);
-
-        return std::pair<iterator, InsertState>(
-                Iterator(this, inv_pos),
-                this->size <= Node::M ? InsertState::SUCCESS : InsertState::TRIGGER_SPLIT // trigger split in parent if temporarily invalid
-        );
+    void merge(key_type&& pulled_down, InternalNode* neighbour) {
+        this->values[this->size] = std::move(pulled_down);
+        ++this->size;
+        std::move(neighbour->values, neighbour->values + neighbour->size, this->values + this->size);
+        std::copy(neighbour->children, neighbour->children + neighbour->size + 1, children + this->size);
+#ifdef ADS_SET_ORDER_STATS
+        std::copy(neighbour->counts, neighbour->counts + neighbour->size + 1, counts + this->size);
+#endif
+        this->size += neighbour->size;
     }
+};
 
-    EraseState remove_elem(const key_type& elem) override {
-        int pos{ this->findpos(elem) };
-        if (pos < 0) return EraseState::NOT_FOUND; // signal not found
-        this->erase_at(static_cast<size_type>(pos));
+template<typename Key, size_t N, typename Allocator, typename Compare>
+struct ADS_set<Key, N, Allocator, Compare>::ExternalNode : public KeyNode<leaf_capacity> {
+    ExternalNode* next;
 
-        return this->size >= N ? EraseState::SUCCESS : EraseState::TRIGGER_MERGE; // trigger merge in parent if temporarily invalid
-    }
+    explicit ExternalNode(ExternalNode* _next = nullptr) : KeyNode<leaf_capacity>(NodeType::EXTERNAL, 0), next{ _next } {}
 
-    std::pair<link, const key_type*> split(size_type split_at) override {
-        // construct array for right node
-        key_type right_arr[Node::M + 1];
-        size_type right_size{ this->size - split_at - 1 };
-        for (size_type i{ 0 }; i < right_size; ++i) {
-            right_arr[i] = this->values[split_at + 1 + i];
-        }
+    // right is an empty node linked to next
+    void split(size_type split_at, ExternalNode* right) {
+        right->size = this->size - split_at - 1;
+        std::move(this->values + split_at + 1, this->values + this->size, right->values);
 
-        // cut array for left array (this)
+        // cut array for left node (this)
         this->size = split_at + 1;
-
-        // construct pair to return
-        ExternalNode* right{ new ExternalNode(right_arr, right_size, next) };
         next = right;
-        return std::pair<link, key_type*>(right, nullptr);
     }
 
-    std::pair<key_type*, link*> get_all() override {
-        key_type* vals = new key_type[this->size];
-        for (size_type i{ 0 }; i < this->size; ++i) {
-            vals[i] = this->values[i];
-        }
-        return std::pair<key_type*, link*>(vals, nullptr);
+    // moves the last count keys of left (the left neighbour) to the front, separator becomes the new first key
+    void borrow_left(key_type& separator, ExternalNode* left, size_type count) {
+        std::move_backward(this->values, this->values + this->size, this->values + this->size + count);
+        std::move(left->values + left->size - count, left->values + left->size, this->values);
+        left->size -= count;
+        this->size += count;
+        separator = this->values[0];
     }
 
-    void prepare_merge(const key_type&) override {
-        // no-op
+    // appends the first count keys of right (the right neighbour), separator becomes its new first key
+    void borrow_right(key_type& separator, ExternalNode* right, size_type count) {
+        std::move(right->values, right->values + count, this->values + this->size);
+        std::move(right->values + count, right->values + right->size, right->values);
+        right->size -= count;
+        this->size += count;
+        separator = right->values[0];
     }
 
-    void merge(link neighbour) override {
-        std::pair<key_type*, link*> elems{ neighbour->get_all() };
-        size_type prev_size{ this->size };
-
-        // ignore elems.second, should be empty anyways
-        for (size_type i{ 0 }; i < neighbour->size; ++i) {
-            this->values[i + prev_size] = elems.first[i];
-        }
+    void merge(ExternalNode* neighbour) {
+        std::move(neighbour->values, neighbour->values + neighbour->size, this->values + this->size);
         this->size += neighbour->size;
-        delete[] elems.first;
 
-        TRACE_INF_IF(next != neighbour, "Merge without pointer advance (if not in rebalance, this is a problem)")
+        TRACE_INF_IF(next != neighbour, "Merge without pointer advance, the neighbour is not the next leaf")
         if (next == neighbour) {
             next = next->next;
         }
     }
 };
 
-template<typename Key, size_t N>
-void swap(ADS_set<Key, N>& lhs, ADS_set<Key, N>& rhs) {
+// the read-only layout of a frozen set. the keys lie in one array of leaves, linked like the leaves of the tree,
+// so that iterators and range scans walk them unchanged. above them sits an implicit B+ tree over blocks of
+// frozen_block keys: node j of a level holds the separators between its children j * (frozen_block + 1) and on
+// in index[offset + j * frozen_block], separator i being the first key below child i + 1. the children of the
+// lowest level are the blocks, block b starts at key b * frozen_block
+template<typename Key, size_t N, typename Allocator, typename Compare>
+struct ADS_set<Key, N, Allocator, Compare>::Frozen {
+    struct Level {
+        size_type offset; // of the first node in index
+        size_type children; // of all nodes of the level together
+        size_type span; // keys below each full child
+    };
+    using leaf_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<ExternalNode>;
+    using key_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<key_type>;
+
+    std::vector<ExternalNode, leaf_allocator> leaves; // frozen_fill keys each, except for the last one
+    std::vector<key_type, key_allocator> index;
+    std::vector<Level> levels; // root first, none if all keys fit into a single block
+
+    Frozen(size_type leaf_count, const Allocator& alloc) : leaves(leaf_count, leaf_allocator(alloc)), index(key_allocator(alloc)) {}
+};
+
+template<typename Key, size_t N, typename Allocator, typename Compare>
+void swap(ADS_set<Key, N, Allocator, Compare>& lhs, ADS_set<Key, N, Allocator, Compare>& rhs) {
     lhs.swap(rhs);
 }
 
+template<typename Key, size_t N, typename Allocator, typename Compare>
+ADS_set<Key, N, Allocator, Compare> set_union(const ADS_set<Key, N, Allocator, Compare>& lhs, const ADS_set<Key, N, Allocator, Compare>& rhs) {
+    return lhs.set_union(rhs);
+}
+
+template<typename Key, size_t N, typename Allocator, typename Compare>
+ADS_set<Key, N, Allocator, Compare> set_intersection(const ADS_set<Key, N, Allocator, Compare>& lhs, const ADS_set<Key, N, Allocator, Compare>& rhs) {
+    return lhs.set_intersection(rhs);
+}
+
+template<typename Key, size_t N, typename Allocator, typename Compare>
+ADS_set<Key, N, Allocator, Compare> set_difference(const ADS_set<Key, N, Allocator, Compare>& lhs, const ADS_set<Key, N, Allocator, Compare>& rhs) {
+    return lhs.set_difference(rhs);
+}
+
 #endif
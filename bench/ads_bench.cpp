@@ -0,0 +1,609 @@
+// benchmark suite for ADS_set, compares several fanouts against std::set and a sorted std::vector, and
+// ADS_packed_set for the integer keys. needs nothing but the standard library.
+//
+// usage: ads_bench [--sizes 1e3,1e4,1e5,1e6] [--ops 1000000] [--repeat 3] [--seed 42]
+//                  [--format csv|json] [--out FILE] [--filter SUBSTRING]
+//
+// workloads: insert_random, insert_sequential, erase_random, find_hit, find_miss, iterate, range_100
+// (ordered scans over 100 keys, through for_each_in_range for ADS_set and ADS_packed_set), find_batch and
+// find_batch_sorted (the find_hit lookups through contains_many in batches of 1024, ADS_set only), rank and nth
+// (order statistics of present keys and random positions, ADS_set only, 1000 queries unless built with
+// ADS_ORDER_STATS), freeze (ADS_set::freeze of a copy, per key), find_hit_frozen and find_miss_frozen (the
+// find_hit and find_miss lookups on the frozen copy, ADS_set only), insert_batch and erase_batch
+// (all misses inserted into a full set / all keys erased, through insert_batch and erase_batch in consecutive
+// sorted batches of 1024, ADS_set only), set_union and set_intersection (of the set with the set of all misses,
+// per key of both inputs, ADS_set only), mixed.
+// every result row holds container, key type, size, workload, number of timed operations, ns/op (median of
+// all repetitions) and the bytes allocated by the container per stored key. --filter selects rows whose
+// "container/key/workload" contains the given substring (before running them).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ADS_packed_set.h"
+#include "ADS_set.h"
+
+namespace {
+
+    // bytes currently held by all containers built with CountingAllocator
+    long long allocated_bytes{ 0 };
+
+    template<typename T>
+    struct CountingAllocator {
+        using value_type = T;
+
+        CountingAllocator() = default;
+
+        template<typename U>
+        CountingAllocator(const CountingAllocator<U>&) {}
+
+        T* allocate(size_t n) {
+            allocated_bytes += static_cast<long long>(n * sizeof(T));
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* ptr, size_t n) {
+            allocated_bytes -= static_cast<long long>(n * sizeof(T));
+            std::allocator<T>().deallocate(ptr, n);
+        }
+
+        template<typename U>
+        bool operator==(const CountingAllocator<U>&) const { return true; }
+
+        template<typename U>
+        bool operator!=(const CountingAllocator<U>&) const { return false; }
+    };
+
+    // sorted, duplicate free vector with the set interface the workloads need
+    template<typename Key>
+    class SortedVector {
+        std::vector<Key, CountingAllocator<Key>> keys;
+
+    public:
+        using const_iterator = typename std::vector<Key, CountingAllocator<Key>>::const_iterator;
+
+        SortedVector() = default;
+
+        // bulk construction, used instead of insert for sizes where inserting one by one is hopeless
+        explicit SortedVector(std::vector<Key> sorted) : keys(sorted.begin(), sorted.end()) {}
+
+        std::pair<const_iterator, bool> insert(const Key& key) {
+            auto it{ std::lower_bound(keys.begin(), keys.end(), key) };
+            if (it != keys.end() && !(key < *it)) return { it, false };
+            return { keys.insert(it, key), true };
+        }
+
+        size_t erase(const Key& key) {
+            auto it{ std::lower_bound(keys.begin(), keys.end(), key) };
+            if (it == keys.end() || key < *it) return 0;
+            keys.erase(it);
+            return 1;
+        }
+
+        const_iterator lower_bound(const Key& key) const {
+            return std::lower_bound(keys.begin(), keys.end(), key);
+        }
+
+        const_iterator find(const Key& key) const {
+            auto it{ std::lower_bound(keys.begin(), keys.end(), key) };
+            return it != keys.end() && !(key < *it) ? it : keys.end();
+        }
+
+        [[nodiscard]] size_t size() const { return keys.size(); }
+
+        const_iterator begin() const { return keys.begin(); }
+
+        const_iterator end() const { return keys.end(); }
+    };
+
+    // inserting or erasing in the middle of a vector is O(n), mutating workloads are skipped above this size
+    constexpr size_t vector_mutation_limit{ 100000 };
+
+    struct Options {
+        std::vector<size_t> sizes{ 1000, 10000, 100000, 1000000 };
+        size_t ops{ 1000000 };
+        unsigned repeat{ 3 };
+        unsigned seed{ 42 };
+        std::string format{ "csv" };
+        std::string out;
+        std::string filter;
+    };
+
+    struct Result {
+        std::string container;
+        std::string key;
+        size_t n;
+        std::string workload;
+        size_t ops;
+        double ns_per_op;
+        double bytes_per_key;
+    };
+
+    // keys of a set of size n are make_key(2 * i), lookups that should miss use make_key(2 * i + 1)
+    template<typename Key>
+    Key make_key(uint64_t i);
+
+    template<>
+    int make_key<int>(uint64_t i) {
+        return static_cast<int>(i);
+    }
+
+    template<>
+    uint64_t make_key<uint64_t>(uint64_t i) {
+        return i * 0x9E3779B97F4A7C15ULL; // odd multiplier -> bijective, spreads keys over the whole range
+    }
+
+    template<>
+    double make_key<double>(uint64_t i) {
+        return static_cast<double>(i) * 0.25;
+    }
+
+    template<>
+    std::string make_key<std::string>(uint64_t i) {
+        char buffer[24];
+        std::snprintf(buffer, sizeof(buffer), "key%012llu", static_cast<unsigned long long>(i));
+        return buffer;
+    }
+
+    template<typename Key>
+    const char* key_name();
+
+    template<>
+    const char* key_name<int>() { return "int32"; }
+
+    template<>
+    const char* key_name<uint64_t>() { return "uint64"; }
+
+    template<>
+    const char* key_name<double>() { return "double"; }
+
+    template<>
+    const char* key_name<std::string>() { return "string"; }
+
+    // keeps the optimizer from dropping lookups whose results are otherwise unused
+    volatile size_t sink;
+
+    template<typename Key>
+    struct KeySet {
+        std::vector<Key> shuffled; // present keys in random order
+        std::vector<Key> sorted; // present keys in ascending order
+        std::vector<Key> misses; // absent keys in random order
+    };
+
+    template<typename Key>
+    KeySet<Key> make_keys(size_t n, std::mt19937_64& rng) {
+        KeySet<Key> keys;
+        keys.shuffled.reserve(n);
+        keys.misses.reserve(n);
+        for (size_t i{ 0 }; i < n; ++i) {
+            keys.shuffled.push_back(make_key<Key>(2 * i));
+            keys.misses.push_back(make_key<Key>(2 * i + 1));
+        }
+        keys.sorted = keys.shuffled;
+        std::sort(keys.sorted.begin(), keys.sorted.end());
+        std::shuffle(keys.shuffled.begin(), keys.shuffled.end(), rng);
+        std::shuffle(keys.misses.begin(), keys.misses.end(), rng);
+        return keys;
+    }
+
+    double median(std::vector<double> samples) {
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    template<typename F>
+    double time_ns(F&& f) {
+        auto start{ std::chrono::steady_clock::now() };
+        f();
+        auto stop{ std::chrono::steady_clock::now() };
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+
+    const char* const workloads[]{ "insert_random", "insert_sequential", "erase_random", "find_hit", "find_miss", "iterate", "range_100", "find_batch",
+                                      "find_batch_sorted", "rank", "nth", "freeze", "find_hit_frozen", "find_miss_frozen", "insert_batch",
+                                      "erase_batch", "set_union", "set_intersection", "mixed" };
+
+    // keys per find_batch, insert_batch and erase_batch call
+    constexpr size_t batch_size{ 1024 };
+
+    // width of the range_100 scans in keys
+    constexpr size_t range_width{ 100 };
+
+    // rank and nth queries per run if ADS_set is built without ADS_SET_ORDER_STATS
+    constexpr size_t order_queries{ 1000 };
+
+    template<typename Container>
+    struct is_ads_set : std::false_type {};
+
+    template<typename Key, size_t N, typename Allocator, typename Compare>
+    struct is_ads_set<ADS_set<Key, N, Allocator, Compare>> : std::true_type {};
+
+    template<typename Container>
+    struct is_packed_set : std::false_type {};
+
+    template<typename Key, typename Allocator>
+    struct is_packed_set<ADS_packed_set<Key, Allocator>> : std::true_type {};
+
+    class Runner {
+        const Options& options;
+        std::vector<Result>& results;
+
+    public:
+        Runner(const Options& _options, std::vector<Result>& _results) : options{ _options }, results{ _results } {}
+
+        [[nodiscard]] bool selected(const std::string& container, const std::string& key, const std::string& workload) const {
+            return options.filter.empty() || (container + '/' + key + '/' + workload).find(options.filter) != std::string::npos;
+        }
+
+        // lets containers skip building anything if none of their workloads runs
+        [[nodiscard]] bool any_selected(const std::string& container, const std::string& key) const {
+            return std::any_of(std::begin(workloads), std::end(workloads), [&](const char* workload) {
+                return selected(container, key, workload);
+            });
+        }
+
+        // runs setup (untimed) and body (timed) options.repeat times, records the median
+        template<typename Setup, typename Body>
+        void measure(const std::string& container, const std::string& key, size_t n, const std::string& workload,
+                     size_t ops, double bytes_per_key, Setup&& setup, Body&& body) {
+            if (!selected(container, key, workload)) return;
+            std::vector<double> samples;
+            for (unsigned r{ 0 }; r < options.repeat; ++r) {
+                setup();
+                samples.push_back(time_ns(body) / static_cast<double>(std::max<size_t>(ops, 1)));
+            }
+            results.push_back(Result{ container, key, n, workload, ops, median(samples), bytes_per_key });
+            std::cerr << container << ' ' << key << " n=" << n << ' ' << workload << ": " << results.back().ns_per_op << " ns/op\n";
+        }
+    };
+
+    // lookups cycle through the key vectors until ops operations are done
+    template<typename Container, typename Key>
+    size_t lookup_all(const Container& c, const std::vector<Key>& keys, size_t ops) {
+        size_t found{ 0 };
+        for (size_t i{ 0 }, j{ 0 }; i < ops; ++i, ++j) {
+            if (j == keys.size()) j = 0;
+            found += c.find(keys[j]) != c.end() ? 1 : 0;
+        }
+        return found;
+    }
+
+    // sums the sizes of all keys in [lo, hi), through the range scan API where the container has one
+    template<typename Container, typename Key>
+    size_t scan(const Container& c, const Key& lo, const Key& hi) {
+        size_t acc{ 0 };
+        if constexpr(is_ads_set<Container>::value || is_packed_set<Container>::value) {
+            c.for_each_in_range(lo, hi, [&acc](const Key& key) { acc += sizeof(key); });
+        } else {
+            for (auto it{ c.lower_bound(lo) }; it != c.end() && *it < hi; ++it) {
+                acc += sizeof(*it);
+            }
+        }
+        return acc;
+    }
+
+    template<typename Container, typename Key>
+    void build(Container& c, const KeySet<Key>& keys) {
+        if constexpr(std::is_same_v<Container, SortedVector<Key>>) {
+            c = Container(keys.sorted);
+        } else {
+            for (const Key& key: keys.shuffled) c.insert(key);
+        }
+    }
+
+    template<typename Container, typename Key>
+    void run_container(Runner& runner, const std::string& name, const KeySet<Key>& keys, const Options& options, std::mt19937_64& rng) {
+        const std::string key{ key_name<Key>() };
+        const size_t n{ keys.sorted.size() };
+        const bool mutable_workloads{ !std::is_same_v<Container, SortedVector<Key>> || n <= vector_mutation_limit };
+        const size_t lookups{ std::max(options.ops, size_t{ 1 }) };
+        if (!runner.any_selected(name, key)) return;
+
+        // memory footprint of a container built by random inserts (bulk construction for the vector)
+        long long before{ allocated_bytes };
+        double bytes_per_key;
+        {
+            Container c;
+            build(c, keys);
+            bytes_per_key = static_cast<double>(allocated_bytes - before) / static_cast<double>(std::max<size_t>(n, 1));
+        }
+
+        if (mutable_workloads) {
+            std::unique_ptr<Container> c;
+            runner.measure(name, key, n, "insert_random", n, bytes_per_key, [&] { c = std::make_unique<Container>(); }, [&] {
+                for (const Key& k: keys.shuffled) c->insert(k);
+            });
+            runner.measure(name, key, n, "insert_sequential", n, bytes_per_key, [&] { c = std::make_unique<Container>(); }, [&] {
+                for (const Key& k: keys.sorted) c->insert(k);
+            });
+            runner.measure(name, key, n, "erase_random", n, bytes_per_key, [&] {
+                c = std::make_unique<Container>();
+                build(*c, keys);
+            }, [&] {
+                for (const Key& k: keys.shuffled) c->erase(k);
+            });
+
+            if constexpr(is_ads_set<Container>::value) {
+                std::vector<Key> misses{ keys.misses };
+                std::sort(misses.begin(), misses.end());
+                runner.measure(name, key, n, "insert_batch", n, bytes_per_key, [&] {
+                    c = std::make_unique<Container>();
+                    build(*c, keys);
+                }, [&] {
+                    for (size_t offset{ 0 }; offset < n; offset += batch_size) {
+                        c->insert_batch(misses.begin() + offset, misses.begin() + std::min(n, offset + batch_size));
+                    }
+                });
+                runner.measure(name, key, n, "erase_batch", n, bytes_per_key, [&] {
+                    c = std::make_unique<Container>();
+                    build(*c, keys);
+                }, [&] {
+                    for (size_t offset{ 0 }; offset < n; offset += batch_size) {
+                        c->erase_batch(keys.sorted.begin() + offset, keys.sorted.begin() + std::min(n, offset + batch_size));
+                    }
+                });
+
+                Container full;
+                build(full, keys);
+                Container other{ misses.begin(), misses.end() };
+                runner.measure(name, key, n, "set_union", 2 * n, bytes_per_key, [] {}, [&] {
+                    sink = full.set_union(other).size();
+                });
+                runner.measure(name, key, n, "set_intersection", 2 * n, bytes_per_key, [] {}, [&] {
+                    sink = full.set_intersection(other).size();
+                });
+            }
+        }
+
+        Container c;
+        build(c, keys);
+        runner.measure(name, key, n, "find_hit", lookups, bytes_per_key, [] {}, [&] {
+            sink = lookup_all(c, keys.shuffled, lookups);
+        });
+        runner.measure(name, key, n, "find_miss", lookups, bytes_per_key, [] {}, [&] {
+            sink = lookup_all(c, keys.misses, lookups);
+        });
+        runner.measure(name, key, n, "iterate", n, bytes_per_key, [] {}, [&] {
+            size_t count{ 0 };
+            for (auto it{ c.begin() }; it != c.end(); ++it) {
+                count += sizeof(*it);
+            }
+            sink = count;
+        });
+
+        if constexpr(is_ads_set<Container>::value) {
+            // the lookups of find_hit, issued through contains_many in batches of batch_size (sorted per batch)
+            std::vector<Key> batches;
+            batches.reserve(lookups);
+            for (size_t i{ 0 }, j{ 0 }; i < lookups && n > 0; ++i, ++j) {
+                if (j == n) j = 0;
+                batches.push_back(keys.shuffled[j]);
+            }
+            std::unique_ptr<bool[]> found{ new bool[batch_size] };
+            auto run_batches{ [&] {
+                size_t acc{ 0 };
+                for (size_t offset{ 0 }; offset < batches.size(); offset += batch_size) {
+                    size_t count{ std::min(batch_size, batches.size() - offset) };
+                    c.contains_many(batches.begin() + offset, batches.begin() + offset + count, found.get());
+                    acc += static_cast<size_t>(std::count(found.get(), found.get() + count, true));
+                }
+                sink = acc;
+            } };
+            runner.measure(name, key, n, "find_batch", batches.size(), bytes_per_key, [] {}, run_batches);
+            for (size_t offset{ 0 }; offset < batches.size(); offset += batch_size) {
+                std::sort(batches.begin() + offset, batches.begin() + offset + std::min(batch_size, batches.size() - offset));
+            }
+            runner.measure(name, key, n, "find_batch_sorted", batches.size(), bytes_per_key, [] {}, run_batches);
+
+            // rank of present keys and nth of random positions. without order statistics both walk the leaf
+            // chain, so they only run a few queries then
+            size_t queries{ std::min(lookups, Container::order_statistics ? lookups : order_queries) };
+            runner.measure(name, key, n, "rank", queries, bytes_per_key, [] {}, [&] {
+                size_t acc{ 0 };
+                for (size_t i{ 0 }; i < queries && n > 0; ++i) {
+                    acc += c.rank(keys.shuffled[i % n]);
+                }
+                sink = acc;
+            });
+            std::uniform_int_distribution<size_t> position{ 0, std::max<size_t>(n, 1) - 1 };
+            std::vector<size_t> positions(queries);
+            for (size_t& pos: positions) {
+                pos = position(rng);
+            }
+            runner.measure(name, key, n, "nth", queries, bytes_per_key, [] {}, [&] {
+                size_t acc{ 0 };
+                for (size_t pos: positions) {
+                    acc += &*c.nth(pos) == &*c.begin() ? 1 : 0;
+                }
+                sink = acc;
+            });
+
+            // the find_hit and find_miss lookups on a frozen copy, the row reports the memory of the frozen layout
+            std::unique_ptr<Container> frozen;
+            runner.measure(name, key, n, "freeze", n, bytes_per_key, [&] { frozen = std::make_unique<Container>(c); }, [&] {
+                frozen->freeze();
+            });
+            if (!frozen) {
+                frozen = std::make_unique<Container>(c);
+                frozen->freeze();
+            }
+            double frozen_bytes_per_key{ frozen->stats().bytes_per_key };
+            runner.measure(name, key, n, "find_hit_frozen", lookups, frozen_bytes_per_key, [] {}, [&] {
+                sink = lookup_all(*frozen, keys.shuffled, lookups);
+            });
+            runner.measure(name, key, n, "find_miss_frozen", lookups, frozen_bytes_per_key, [] {}, [&] {
+                sink = lookup_all(*frozen, keys.misses, lookups);
+            });
+        }
+
+        if (n > range_width) {
+            std::vector<std::pair<const Key*, const Key*>> ranges;
+            std::uniform_int_distribution<size_t> start{ 0, n - range_width - 1 };
+            for (size_t i{ 0 }; i < std::max<size_t>(lookups / range_width, 1); ++i) {
+                size_t first{ start(rng) };
+                ranges.emplace_back(&keys.sorted[first], &keys.sorted[first + range_width]);
+            }
+            runner.measure(name, key, n, "range_100", ranges.size(), bytes_per_key, [] {}, [&] {
+                size_t acc{ 0 };
+                for (const auto& [lo, hi]: ranges) {
+                    acc += scan(c, *lo, *hi);
+                }
+                sink = acc;
+            });
+        }
+
+        if (mutable_workloads) {
+            // 50% lookups (half of them misses), 25% inserts of absent keys, 25% erases of present keys
+            std::vector<std::pair<int, const Key*>> stream;
+            stream.reserve(lookups);
+            std::uniform_int_distribution<size_t> pick{ 0, std::max<size_t>(n, 1) - 1 };
+            for (size_t i{ 0 }; i < lookups && n > 0; ++i) {
+                int op{ static_cast<int>(rng() % 4) };
+                const Key* k{ op == 2 ? &keys.misses[pick(rng)] : &keys.shuffled[pick(rng)] };
+                if (op == 1 && rng() % 2) k = &keys.misses[pick(rng)];
+                stream.emplace_back(op, k);
+            }
+            std::unique_ptr<Container> m;
+            runner.measure(name, key, n, "mixed", stream.size(), bytes_per_key, [&] {
+                m = std::make_unique<Container>();
+                build(*m, keys);
+            }, [&] {
+                size_t acc{ 0 };
+                for (const auto& [op, k]: stream) {
+                    if (op < 2) {
+                        acc += m->find(*k) != m->end() ? 1 : 0;
+                    } else if (op == 2) {
+                        acc += m->insert(*k).second ? 1 : 0;
+                    } else {
+                        acc += m->erase(*k);
+                    }
+                }
+                sink = acc;
+            });
+        }
+    }
+
+    template<typename Key, size_t N>
+    using Tree = ADS_set<Key, N, CountingAllocator<Key>>;
+
+    template<typename Key>
+    void run_key(Runner& runner, const Options& options) {
+        std::mt19937_64 rng{ options.seed };
+        for (size_t n: options.sizes) {
+            KeySet<Key> keys{ make_keys<Key>(n, rng) };
+            run_container<Tree<Key, 0>>(runner, "ADS_set<auto>", keys, options, rng);
+            run_container<Tree<Key, 2>>(runner, "ADS_set<2>", keys, options, rng);
+            run_container<Tree<Key, 8>>(runner, "ADS_set<8>", keys, options, rng);
+            run_container<Tree<Key, 32>>(runner, "ADS_set<32>", keys, options, rng);
+            run_container<Tree<Key, 128>>(runner, "ADS_set<128>", keys, options, rng);
+            if constexpr(std::is_integral_v<Key>) {
+                run_container<ADS_packed_set<Key, CountingAllocator<Key>>>(runner, "ADS_packed_set", keys, options, rng);
+            }
+            run_container<std::set<Key, std::less<Key>, CountingAllocator<Key>>>(runner, "std::set", keys, options, rng);
+            run_container<SortedVector<Key>>(runner, "sorted_vector", keys, options, rng);
+        }
+    }
+
+    void write_csv(std::ostream& o, const std::vector<Result>& results) {
+        o << "container,key,n,workload,ops,ns_per_op,bytes_per_key\n";
+        for (const Result& r: results) {
+            o << r.container << ',' << r.key << ',' << r.n << ',' << r.workload << ',' << r.ops << ','
+              << r.ns_per_op << ',' << r.bytes_per_key << '\n';
+        }
+    }
+
+    void write_json(std::ostream& o, const std::vector<Result>& results) {
+        o << "[\n";
+        for (size_t i{ 0 }; i < results.size(); ++i) {
+            const Result& r{ results[i] };
+            o << "  {\"container\": \"" << r.container << "\", \"key\": \"" << r.key << "\", \"n\": " << r.n
+              << ", \"workload\": \"" << r.workload << "\", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.ns_per_op
+              << ", \"bytes_per_key\": " << r.bytes_per_key << '}' << (i + 1 < results.size() ? "," : "") << '\n';
+        }
+        o << "]\n";
+    }
+
+    std::vector<size_t> parse_sizes(const std::string& list) {
+        std::vector<size_t> sizes;
+        std::stringstream stream{ list };
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            sizes.push_back(static_cast<size_t>(std::stod(item))); // accepts 1e6 as well as 1000000
+        }
+        return sizes;
+    }
+
+    void usage() {
+        std::cerr << "usage: ads_bench [--sizes 1e3,1e4,...] [--ops N] [--repeat N] [--seed N] "
+                     "[--format csv|json] [--out FILE] [--filter SUBSTRING]\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i{ 1 }; i < argc; ++i) {
+        std::string arg{ argv[i] };
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value{ argv[++i] };
+        if (arg == "--sizes") {
+            options.sizes = parse_sizes(value);
+        } else if (arg == "--ops") {
+            options.ops = static_cast<size_t>(std::stod(value));
+        } else if (arg == "--repeat") {
+            options.repeat = static_cast<unsigned>(std::max(1, std::stoi(value)));
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--format") {
+            options.format = value;
+        } else if (arg == "--out") {
+            options.out = value;
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (options.format != "csv" && options.format != "json") {
+        usage();
+        return 1;
+    }
+
+    std::vector<Result> results;
+    Runner runner{ options, results };
+    run_key<int>(runner, options);
+    run_key<uint64_t>(runner, options);
+    run_key<double>(runner, options);
+    run_key<std::string>(runner, options);
+
+    std::ofstream file;
+    if (!options.out.empty()) {
+        file.open(options.out);
+        if (!file) {
+            std::cerr << "cannot open " << options.out << '\n';
+            return 1;
+        }
+    }
+    std::ostream& o{ options.out.empty() ? std::cout : file };
+    if (options.format == "json") {
+        write_json(o, results);
+    } else {
+        write_csv(o, results);
+    }
+    return 0;
+}
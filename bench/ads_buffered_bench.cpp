@@ -0,0 +1,248 @@
+// ADS_buffered_set against the plain ADS_set and std::set. needs nothing but the standard library.
+//
+// usage: ads_buffered_bench [--keys 1e6] [--lookups 1000000] [--seed 42] [--format csv|json] [--out FILE]
+//
+// keys are random uint64_t. workloads per container:
+// - insert: all keys in random order
+// - find_hit: random present keys, pending messages are still in the buffers
+// - find_miss: random absent keys
+// - size: one call, the buffered set counts what its pending messages change
+// - empty: one call per lookup, as in an ingest loop that checks the set between writes
+// - iterate: all keys in order
+// - flush: one call, applies the pending messages of the buffered set, nothing to do for the others
+// - find_hit_flushed: random present keys once the buffers are empty
+// - erase: all keys in random order
+// - insert_erase: inserts and erases of random keys in turn on a set of all keys, size checked afterwards
+// every result row holds container, keys, workload, ns/op and the number of wrong results. the exit code is 1
+// if any result was wrong.
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "ADS_buffered_set.h"
+#include "ADS_set.h"
+#include "bench_common.h"
+
+namespace {
+
+    using Key = uint64_t;
+
+    struct Options {
+        size_t keys{ 1000000 };
+        size_t lookups{ 1000000 };
+    };
+
+    // the three containers behind one interface. inserts and erases of the buffered set are blind, the others
+    // do not report their result either to keep the comparison fair
+    struct BufferedAdapter {
+        ADS_buffered_set<Key> set;
+        static constexpr const char* name{ "ADS_buffered_set" };
+
+        void insert(Key key) {
+            set.insert(key);
+        }
+
+        void erase(Key key) {
+            set.erase(key);
+        }
+
+        void flush() {
+            set.flush();
+        }
+
+        size_t count(Key key) const {
+            return set.count(key);
+        }
+
+        size_t size() const {
+            return set.size();
+        }
+
+        bool empty() const {
+            return set.empty();
+        }
+
+        template<typename F>
+        void scan(F&& f) const {
+            for (Key key: set) {
+                f(key);
+            }
+        }
+    };
+
+    struct SetAdapter {
+        ADS_set<Key> set;
+        static constexpr const char* name{ "ADS_set" };
+
+        void insert(Key key) {
+            set.insert(key);
+        }
+
+        void erase(Key key) {
+            set.erase(key);
+        }
+
+        void flush() {}
+
+        size_t count(Key key) const {
+            return set.count(key);
+        }
+
+        size_t size() const {
+            return set.size();
+        }
+
+        bool empty() const {
+            return set.empty();
+        }
+
+        template<typename F>
+        void scan(F&& f) const {
+            for (Key key: set) {
+                f(key);
+            }
+        }
+    };
+
+    struct StdSetAdapter {
+        std::set<Key> set;
+        static constexpr const char* name{ "std::set" };
+
+        void insert(Key key) {
+            set.insert(key);
+        }
+
+        void erase(Key key) {
+            set.erase(key);
+        }
+
+        void flush() {}
+
+        size_t count(Key key) const {
+            return set.count(key);
+        }
+
+        size_t size() const {
+            return set.size();
+        }
+
+        bool empty() const {
+            return set.empty();
+        }
+
+        template<typename F>
+        void scan(F&& f) const {
+            for (Key key: set) {
+                f(key);
+            }
+        }
+    };
+
+    template<typename Body>
+    void measure(ads_bench::Results& results, const char* container, size_t keys, const char* workload, size_t ops, Body&& body) {
+        size_t errors{ 0 };
+        double seconds{ ads_bench::seconds([&] { errors = body(); }) };
+        results.add({ container, keys, workload, ads_bench::ns_per_op(seconds, ops), errors });
+    }
+
+    template<typename Adapter>
+    void run(ads_bench::Results& results, const std::vector<Key>& keys, const std::vector<Key>& hits, const std::vector<Key>& misses) {
+        Adapter c;
+        measure(results, Adapter::name, keys.size(), "insert", keys.size(), [&] {
+            for (Key key: keys) {
+                c.insert(key);
+            }
+            return size_t{ 0 };
+        });
+        auto find = [&](const std::vector<Key>& lookups, size_t expected) {
+            size_t errors{ 0 };
+            for (Key key: lookups) {
+                errors += c.count(key) == expected ? 0 : 1;
+            }
+            return errors;
+        };
+        measure(results, Adapter::name, keys.size(), "find_hit", hits.size(), [&] { return find(hits, 1); });
+        measure(results, Adapter::name, keys.size(), "find_miss", misses.size(), [&] { return find(misses, 0); });
+        measure(results, Adapter::name, keys.size(), "size", 1, [&] { return size_t{ c.size() == keys.size() ? 0u : 1u }; });
+        measure(results, Adapter::name, keys.size(), "empty", hits.size(), [&] {
+            size_t errors{ 0 };
+            for (size_t i{ 0 }; i < hits.size(); ++i) {
+                errors += c.empty() ? 1 : 0;
+            }
+            return errors;
+        });
+        measure(results, Adapter::name, keys.size(), "iterate", keys.size(), [&] {
+            size_t visited{ 0 };
+            Key previous{ 0 };
+            size_t errors{ 0 };
+            c.scan([&](Key key) {
+                errors += visited > 0 && key <= previous ? 1 : 0;
+                previous = key;
+                ++visited;
+            });
+            return errors + (visited == keys.size() ? 0 : 1);
+        });
+        measure(results, Adapter::name, keys.size(), "flush", 1, [&] {
+            c.flush();
+            return size_t{ 0 };
+        });
+        measure(results, Adapter::name, keys.size(), "find_hit_flushed", hits.size(), [&] { return find(hits, 1); });
+        measure(results, Adapter::name, keys.size(), "erase", keys.size(), [&] {
+            for (Key key: keys) {
+                c.erase(key);
+            }
+            return size_t{ c.size() == 0 ? 0u : 1u };
+        });
+
+        Adapter mixed;
+        for (Key key: keys) {
+            mixed.insert(key);
+        }
+        mixed.flush();
+        // hits and misses may repeat, so the expected size is counted up front
+        size_t expected{ keys.size() - std::set<Key>(hits.begin(), hits.end()).size() + std::set<Key>(misses.begin(), misses.end()).size() };
+        measure(results, Adapter::name, keys.size(), "insert_erase", 2 * misses.size(), [&] {
+            for (size_t i{ 0 }; i < misses.size(); ++i) {
+                mixed.insert(misses[i]);
+                mixed.erase(hits[i]);
+            }
+            return size_t{ mixed.size() == expected ? 0u : 1u };
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    ads_bench::CommandLine command_line{ "ads_buffered_bench" };
+    command_line.count("--keys", options.keys);
+    command_line.count("--lookups", options.lookups);
+    if (!command_line.parse(argc, argv)) return 1;
+
+    // keys are the even numbers drawn, misses the odd ones, so both sets never overlap
+    std::mt19937_64 rng{ command_line.seed };
+    std::vector<Key> keys(options.keys);
+    for (Key& key: keys) {
+        key = rng() & ~Key{ 1 };
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::vector<Key> hits(options.lookups);
+    std::uniform_int_distribution<size_t> pick{ 0, keys.size() - 1 };
+    for (Key& key: hits) {
+        key = keys[pick(rng)];
+    }
+    std::vector<Key> misses(options.lookups);
+    for (Key& key: misses) {
+        key = rng() | 1;
+    }
+
+    ads_bench::Results results{ { "container", "keys", "workload", "ns_per_op", "errors" } };
+    run<BufferedAdapter>(results, keys, hits, misses);
+    run<SetAdapter>(results, keys, hits, misses);
+    run<StdSetAdapter>(results, keys, hits, misses);
+    return results.finish(command_line);
+}
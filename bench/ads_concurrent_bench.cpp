@@ -0,0 +1,211 @@
+// multi-threaded stress and throughput test for ADS_concurrent_set, with ADS_set behind a single mutex
+// as the baseline. needs nothing but the standard library.
+//
+// usage: ads_concurrent_bench [--keys 1e6] [--readers 0,1,2,4,8] [--writers 0,1,2,4,8] [--duration-ms 1000]
+//                             [--scan-every 16] [--seed 42] [--format csv|json] [--out FILE]
+//
+// the set is preloaded with the keys 2 * i (i < keys), which stay in the set for the whole run. every
+// combination of reader and writer thread counts runs for the given duration:
+// - writer w owns the odd keys 2 * i + 1 with i % writers == w and toggles random ones of them (insert if
+//   absent, erase if present). no other thread touches them, so every insert and erase has a known outcome
+// - readers look up random preloaded keys, which always have to be found, and every scan-every-th operation
+//   scans 100 preloaded keys through for_each_in_range, which has to see exactly them, in ascending order
+// afterwards the contents are checked against what the writers left behind. every result row holds container,
+// keys, readers, writers, million reads/s, million writes/s and the number of violated expectations.
+// the exit code is 1 if any expectation was violated.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ADS_concurrent_set.h"
+#include "bench_common.h"
+
+namespace {
+
+    using Key = uint64_t;
+
+    // width of the scans in preloaded keys
+    constexpr Key range_width{ 100 };
+
+    struct Options {
+        size_t keys{ 1000000 };
+        std::vector<unsigned> readers{ 0, 1, 2, 4, 8 };
+        std::vector<unsigned> writers{ 0, 1, 2, 4, 8 };
+        unsigned duration_ms{ 1000 };
+        unsigned scan_every{ 16 };
+        unsigned seed{ 42 };
+    };
+
+    // the baseline: the sequential set, serialized by one mutex
+    class LockedSet {
+        ADS_set<Key> set;
+        mutable std::mutex mutex;
+
+    public:
+        bool insert(Key key) {
+            std::lock_guard<std::mutex> guard{ mutex };
+            return set.insert(key).second;
+        }
+
+        size_t erase(Key key) {
+            std::lock_guard<std::mutex> guard{ mutex };
+            return set.erase(key);
+        }
+
+        bool contains(Key key) const {
+            std::lock_guard<std::mutex> guard{ mutex };
+            return set.count(key) == 1;
+        }
+
+        template<typename Visitor>
+        size_t for_each_in_range(Key lo, Key hi, Visitor&& visitor) const {
+            std::lock_guard<std::mutex> guard{ mutex };
+            return set.for_each_in_range(lo, hi, visitor);
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> guard{ mutex };
+            return set.size();
+        }
+    };
+
+    // visits [lo, hi) and checks that the preloaded keys in it are seen exactly once, in ascending order
+    template<typename Set>
+    bool check_scan(const Set& set, Key lo, Key hi, Key expected_even) {
+        Key previous{ 0 };
+        bool first{ true };
+        bool ordered{ true };
+        Key even{ 0 };
+        set.for_each_in_range(lo, hi, [&](const Key& key) {
+            if (!first && !(previous < key)) ordered = false;
+            if (key < lo || !(key < hi)) ordered = false;
+            first = false;
+            previous = key;
+            even += key % 2 == 0 ? 1 : 0;
+        });
+        return ordered && even == expected_even;
+    }
+
+    template<typename Set>
+    void run(ads_bench::Results& results, const char* name, const Options& options, unsigned readers, unsigned writers) {
+        const Key n{ options.keys };
+        Set set;
+        for (Key i{ 0 }; i < n; ++i) {
+            set.insert(2 * i);
+        }
+
+        std::atomic<bool> start{ false };
+        std::atomic<bool> stop{ false };
+        std::atomic<size_t> reads{ 0 };
+        std::atomic<size_t> writes{ 0 };
+        std::atomic<size_t> errors{ 0 };
+        std::vector<std::vector<bool>> owned(writers); // per writer: which of its keys it left in the set
+        std::vector<std::thread> threads;
+
+        for (unsigned w{ 0 }; w < writers; ++w) {
+            threads.emplace_back([&, w] {
+                std::mt19937_64 rng{ options.seed + w };
+                std::vector<bool>& present{ owned[w] };
+                present.assign(static_cast<size_t>((n + writers - 1 - w) / writers), false);
+                if (present.empty()) return;
+                std::uniform_int_distribution<size_t> pick{ 0, present.size() - 1 };
+                size_t ops{ 0 };
+                size_t failed{ 0 };
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                while (!stop.load(std::memory_order_relaxed)) {
+                    size_t slot{ pick(rng) };
+                    Key key{ 2 * (slot * writers + w) + 1 };
+                    if (present[slot]) {
+                        failed += set.erase(key) == 1 ? 0 : 1;
+                    } else {
+                        failed += set.insert(key) ? 0 : 1;
+                    }
+                    present[slot] = !present[slot];
+                    ++ops;
+                }
+                writes += ops;
+                errors += failed;
+            });
+        }
+        for (unsigned r{ 0 }; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                std::mt19937_64 rng{ options.seed + 1000 + r };
+                std::uniform_int_distribution<Key> pick{ 0, n - 1 };
+                std::uniform_int_distribution<Key> pick_range{ 0, n > range_width ? n - range_width : 0 };
+                size_t ops{ 0 };
+                size_t failed{ 0 };
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                while (!stop.load(std::memory_order_relaxed)) {
+                    if (options.scan_every > 0 && ops % options.scan_every == options.scan_every - 1) {
+                        Key first{ pick_range(rng) };
+                        Key count{ std::min(range_width, n - first) };
+                        failed += check_scan(set, 2 * first, 2 * (first + count), count) ? 0 : 1;
+                    } else {
+                        failed += set.contains(2 * pick(rng)) ? 0 : 1;
+                    }
+                    ++ops;
+                }
+                reads += ops;
+                errors += failed;
+            });
+        }
+
+        auto begin{ std::chrono::steady_clock::now() };
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+        stop.store(true, std::memory_order_relaxed);
+        for (std::thread& thread: threads) {
+            thread.join();
+        }
+        double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() };
+
+        // whatever the writers left behind has to be there, nothing else
+        size_t expected{ static_cast<size_t>(n) };
+        for (unsigned w{ 0 }; w < writers; ++w) {
+            for (size_t slot{ 0 }; slot < owned[w].size(); ++slot) {
+                Key key{ 2 * (slot * writers + w) + 1 };
+                errors += set.contains(key) == owned[w][slot] ? 0 : 1;
+                expected += owned[w][slot] ? 1 : 0;
+            }
+        }
+        errors += set.size() == expected ? 0 : 1;
+        size_t scanned{ 0 };
+        Key previous{ 0 };
+        set.for_each_in_range(Key{ 0 }, 2 * n + 1, [&](const Key& key) {
+            if (scanned > 0 && !(previous < key)) ++errors;
+            previous = key;
+            ++scanned;
+        });
+        errors += scanned == expected ? 0 : 1;
+
+        results.add({ name, static_cast<size_t>(n), readers, writers, reads / seconds / 1e6, writes / seconds / 1e6, errors.load() });
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    ads_bench::CommandLine command_line{ "ads_concurrent_bench" };
+    command_line.count("--keys", options.keys);
+    command_line.counts("--readers", options.readers, true);
+    command_line.counts("--writers", options.writers, true);
+    command_line.count("--duration-ms", options.duration_ms);
+    command_line.count("--scan-every", options.scan_every, true);
+    if (!command_line.parse(argc, argv)) return 1;
+    options.seed = command_line.seed;
+
+    ads_bench::Results results{ { "container", "keys", "readers", "writers", "read_mops", "write_mops", "errors" } };
+    for (unsigned writers: options.writers) {
+        for (unsigned readers: options.readers) {
+            if (readers + writers == 0) continue;
+            run<ADS_concurrent_set<Key>>(results, "ADS_concurrent_set", options, readers, writers);
+            run<LockedSet>(results, "ADS_set+mutex", options, readers, writers);
+        }
+    }
+    return results.finish(command_line);
+}
@@ -0,0 +1,213 @@
+// ADS_map against the ways to get an ordered map without it: ADS_set over std::pair<Key, Value> (searched with
+// lower_bound on a pair with an empty value, every comparison reads through the payload) and std::map. needs
+// nothing but the standard library.
+//
+// usage: ads_map_bench [--keys 1e6] [--lookups 1000000] [--seed 42] [--format csv|json] [--out FILE]
+//
+// keys are random uint64_t, values are Payload<bytes> of 8 and 64 bytes. workloads per container and payload:
+// - insert: all keys in random order
+// - find_hit: random present keys, the first payload word is read
+// - update: the first payload word of random present keys is incremented in place
+// - iterate: all entries in order, the first payload word of each is read
+// - erase: all keys in random order
+// every result row holds container, payload bytes, keys, workload, ns/op and the number of wrong results.
+// the exit code is 1 if any result was wrong.
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "ADS_map.h"
+#include "ADS_set.h"
+#include "bench_common.h"
+
+namespace {
+
+    using Key = uint64_t;
+
+    template<size_t bytes>
+    struct Payload {
+        uint64_t words[bytes / sizeof(uint64_t)]{};
+    };
+
+    struct Options {
+        size_t keys{ 1000000 };
+        size_t lookups{ 1000000 };
+    };
+
+    // the three containers behind one interface: insert, the payload of a present key and a scan
+    template<typename Value>
+    struct MapAdapter {
+        ADS_map<Key, Value> map;
+        static constexpr const char* name{ "ADS_map" };
+
+        void insert(Key key, const Value& value) {
+            map.try_emplace(key, value);
+        }
+
+        Value* find(Key key) {
+            auto it{ map.find(key) };
+            return it == map.end() ? nullptr : &it->second;
+        }
+
+        template<typename F>
+        void scan(F&& f) {
+            for (auto entry: map) {
+                f(entry.first, entry.second);
+            }
+        }
+
+        size_t erase(Key key) {
+            return map.erase(key);
+        }
+    };
+
+    // today's workaround. the set hands out const keys, values are changed through a const_cast, which is fine
+    // as long as the ordering only looks at first
+    template<typename Value>
+    struct PairSetAdapter {
+        struct ByKey {
+            bool operator()(const std::pair<Key, Value>& lhs, const std::pair<Key, Value>& rhs) const {
+                return lhs.first < rhs.first;
+            }
+        };
+        ADS_set<std::pair<Key, Value>, 0, std::allocator<std::pair<Key, Value>>, ByKey> set;
+        static constexpr const char* name{ "ADS_set<pair>" };
+
+        void insert(Key key, const Value& value) {
+            set.insert(std::pair<Key, Value>(key, value));
+        }
+
+        Value* find(Key key) {
+            auto it{ set.find(std::pair<Key, Value>(key, Value{})) };
+            return it == set.end() ? nullptr : const_cast<Value*>(&it->second);
+        }
+
+        template<typename F>
+        void scan(F&& f) {
+            for (const auto& entry: set) {
+                f(entry.first, entry.second);
+            }
+        }
+
+        size_t erase(Key key) {
+            return set.erase(std::pair<Key, Value>(key, Value{}));
+        }
+    };
+
+    template<typename Value>
+    struct StdMapAdapter {
+        std::map<Key, Value> map;
+        static constexpr const char* name{ "std::map" };
+
+        void insert(Key key, const Value& value) {
+            map.try_emplace(key, value);
+        }
+
+        Value* find(Key key) {
+            auto it{ map.find(key) };
+            return it == map.end() ? nullptr : &it->second;
+        }
+
+        template<typename F>
+        void scan(F&& f) {
+            for (const auto& entry: map) {
+                f(entry.first, entry.second);
+            }
+        }
+
+        size_t erase(Key key) {
+            return map.erase(key);
+        }
+    };
+
+    template<typename Body>
+    void measure(ads_bench::Results& results, const char* container, size_t payload, size_t keys, const char* workload, size_t ops, Body&& body) {
+        size_t errors{ 0 };
+        double seconds{ ads_bench::seconds([&] { errors = body(); }) };
+        results.add({ container, payload, keys, workload, ads_bench::ns_per_op(seconds, ops), errors });
+    }
+
+    template<typename Adapter, size_t bytes>
+    void run(ads_bench::Results& results, const std::vector<Key>& keys, const std::vector<Key>& lookups) {
+        using Value = Payload<bytes>;
+        Adapter c;
+        measure(results, Adapter::name, bytes, keys.size(), "insert", keys.size(), [&] {
+            for (Key key: keys) {
+                Value value;
+                value.words[0] = key;
+                c.insert(key, value);
+            }
+            return size_t{ 0 };
+        });
+        measure(results, Adapter::name, bytes, keys.size(), "find_hit", lookups.size(), [&] {
+            size_t errors{ 0 };
+            for (Key key: lookups) {
+                Value* value{ c.find(key) };
+                errors += value && value->words[0] == key ? 0 : 1;
+            }
+            return errors;
+        });
+        measure(results, Adapter::name, bytes, keys.size(), "update", lookups.size(), [&] {
+            for (Key key: lookups) {
+                ++c.find(key)->words[0];
+            }
+            return size_t{ 0 };
+        });
+        measure(results, Adapter::name, bytes, keys.size(), "iterate", keys.size(), [&] {
+            size_t visited{ 0 };
+            Key previous{ 0 };
+            size_t errors{ 0 };
+            c.scan([&](Key key, const Value& value) {
+                errors += (visited > 0 && key <= previous) || value.words[0] < key ? 1 : 0;
+                previous = key;
+                ++visited;
+            });
+            return errors + (visited == keys.size() ? 0 : 1);
+        });
+        measure(results, Adapter::name, bytes, keys.size(), "erase", keys.size(), [&] {
+            size_t errors{ 0 };
+            for (Key key: keys) {
+                errors += c.erase(key) == 1 ? 0 : 1;
+            }
+            return errors;
+        });
+    }
+
+    template<size_t bytes>
+    void run_payload(ads_bench::Results& results, const std::vector<Key>& keys, const std::vector<Key>& lookups) {
+        run<MapAdapter<Payload<bytes>>, bytes>(results, keys, lookups);
+        run<PairSetAdapter<Payload<bytes>>, bytes>(results, keys, lookups);
+        run<StdMapAdapter<Payload<bytes>>, bytes>(results, keys, lookups);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    ads_bench::CommandLine command_line{ "ads_map_bench" };
+    command_line.count("--keys", options.keys);
+    command_line.count("--lookups", options.lookups);
+    if (!command_line.parse(argc, argv)) return 1;
+
+    std::mt19937_64 rng{ command_line.seed };
+    std::vector<Key> keys(options.keys);
+    for (Key& key: keys) {
+        key = rng();
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::vector<Key> lookups(options.lookups);
+    std::uniform_int_distribution<size_t> pick{ 0, keys.size() - 1 };
+    for (Key& key: lookups) {
+        key = keys[pick(rng)];
+    }
+
+    ads_bench::Results results{ { "container", "payload", "keys", "workload", "ns_per_op", "errors" } };
+    run_payload<8>(results, keys, lookups);
+    run_payload<64>(results, keys, lookups);
+    return results.finish(command_line);
+}
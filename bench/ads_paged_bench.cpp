@@ -0,0 +1,131 @@
+// out-of-core test for ADS_paged_set: a key set is built, queried and partially erased through buffer pools of
+// different sizes, usually far smaller than the file. needs nothing but the standard library and POSIX.
+//
+// usage: ads_paged_bench [--keys 1e6] [--frames 64,1024,16384] [--lookups 200000] [--file ads_paged_bench.ads]
+//                        [--seed 42] [--format csv|json] [--out FILE]
+//
+// for every pool size the file is recreated and
+// - insert: the keys 2 * i (i < keys) are inserted in random order
+// - find_hit / find_miss: random present keys 2 * i and absent keys 2 * i + 1 are counted
+// - erase: every third key is erased
+// - scan: all keys are visited through for_each_in_range, which has to see exactly the remaining ones
+// - reopen: the file is flushed, reopened and checked with random lookups
+// every result row holds frames, keys, pages of the file, phase, ns/op, the hit rate of the buffer pool during
+// the phase and the number of wrong results. the exit code is 1 if any result was wrong.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ADS_paged_set.h"
+#include "bench_common.h"
+
+namespace {
+
+    using Key = uint64_t;
+    using Set = ADS_paged_set<Key>;
+
+    struct Options {
+        size_t keys{ 1000000 };
+        std::vector<size_t> frames{ 64, 1024, 16384 };
+        size_t lookups{ 200000 };
+        std::string file{ "ads_paged_bench.ads" };
+        unsigned seed{ 42 };
+    };
+
+    // runs body, which performs ops operations on set, and records the time and pool counters of the run
+    template<typename Body>
+    void phase(ads_bench::Results& results, Set& set, const Options& options, size_t frames, const char* name, size_t ops, Body&& body) {
+        Set::Stats before{ set.stats() };
+        size_t errors{ 0 };
+        double seconds{ ads_bench::seconds([&] { errors = body(); }) };
+        Set::Stats after{ set.stats() };
+        double hits{ static_cast<double>(after.hits - before.hits) };
+        double accesses{ hits + static_cast<double>(after.misses - before.misses) };
+        results.add({ frames, options.keys, set.pages(), name, ads_bench::ns_per_op(seconds, ops), accesses > 0 ? hits / accesses : 1.0, errors });
+    }
+
+    void run(ads_bench::Results& results, const Options& options, size_t frames) {
+        const size_t n{ options.keys };
+        std::mt19937_64 rng{ options.seed };
+        std::vector<Key> order(n);
+        std::iota(order.begin(), order.end(), Key{ 0 });
+        std::shuffle(order.begin(), order.end(), rng);
+        std::uniform_int_distribution<Key> pick{ 0, n - 1 };
+        std::remove(options.file.c_str());
+        {
+            Set set{ options.file, frames };
+            phase(results, set, options, frames, "insert", n, [&] {
+                size_t errors{ 0 };
+                for (Key i: order) {
+                    errors += set.insert(2 * i) ? 0 : 1;
+                }
+                return errors;
+            });
+            phase(results, set, options, frames, "find_hit", options.lookups, [&] {
+                size_t errors{ 0 };
+                for (size_t i{ 0 }; i < options.lookups; ++i) {
+                    errors += set.count(2 * pick(rng)) == 1 ? 0 : 1;
+                }
+                return errors;
+            });
+            phase(results, set, options, frames, "find_miss", options.lookups, [&] {
+                size_t errors{ 0 };
+                for (size_t i{ 0 }; i < options.lookups; ++i) {
+                    errors += set.count(2 * pick(rng) + 1) == 0 ? 0 : 1;
+                }
+                return errors;
+            });
+            phase(results, set, options, frames, "erase", (n + 2) / 3, [&] {
+                size_t errors{ 0 };
+                for (Key i: order) {
+                    if (i % 3 == 0) errors += set.erase(2 * i) == 1 ? 0 : 1;
+                }
+                return errors;
+            });
+            phase(results, set, options, frames, "scan", n, [&] {
+                size_t errors{ 0 };
+                Key expected{ 1 }; // i of the next key that has to be visited
+                set.for_each_in_range(Key{ 0 }, 2 * n, [&](const Key& key) {
+                    errors += key == 2 * expected ? 0 : 1;
+                    expected += expected % 3 == 2 ? 2 : 1;
+                });
+                errors += expected >= n && expected - n < 3 ? 0 : 1;
+                errors += set.size() == n - (n + 2) / 3 ? 0 : 1;
+                return errors;
+            });
+            set.flush();
+        }
+        Set set{ options.file, frames };
+        phase(results, set, options, frames, "reopen", options.lookups, [&] {
+            size_t errors{ 0 };
+            for (size_t i{ 0 }; i < options.lookups; ++i) {
+                Key key{ pick(rng) };
+                errors += set.count(2 * key) == (key % 3 == 0 ? 0 : 1) ? 0 : 1;
+            }
+            return errors;
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    ads_bench::CommandLine command_line{ "ads_paged_bench" };
+    command_line.count("--keys", options.keys);
+    command_line.counts("--frames", options.frames);
+    command_line.count("--lookups", options.lookups);
+    command_line.text("--file", "PATH", options.file);
+    if (!command_line.parse(argc, argv)) return 1;
+    options.seed = command_line.seed;
+
+    ads_bench::Results results{ { "frames", "keys", "pages", "phase", "ns_per_op", "hit_rate", "errors" } };
+    for (size_t frames: options.frames) {
+        run(results, options, frames);
+    }
+    std::remove(options.file.c_str());
+    return results.finish(command_line);
+}
@@ -0,0 +1,222 @@
+#ifndef ADS_BENCH_COMMON_H
+#define ADS_BENCH_COMMON_H
+
+// command line, timing and result output shared by the benchmarks, each of which only defines its workloads
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ads_bench {
+
+    // runs body once and returns the seconds it took
+    template<typename Body>
+    double seconds(Body&& body) {
+        auto begin{ std::chrono::steady_clock::now() };
+        body();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    inline double ns_per_op(double seconds, size_t ops) {
+        return seconds * 1e9 / static_cast<double>(std::max<size_t>(ops, 1));
+    }
+
+    // counts are read as doubles, so 1e6 is accepted as well as 1000000
+    inline size_t parse_count(const std::string& text) {
+        size_t used;
+        double value{ std::stod(text, &used) };
+        if (used != text.size() || value < 0) throw std::invalid_argument(text);
+        return static_cast<size_t>(value);
+    }
+
+    // every option takes a value. --seed, --format csv|json and --out FILE are common to all benchmarks, the
+    // others are registered with the member they set before parse. counts have to be positive, a benchmark
+    // with no keys or no lookups measures nothing, unless 0 is registered as meaningful (e.g. no reader threads)
+    class CommandLine {
+        struct Option {
+            std::string flag;
+            std::string placeholder;
+            std::function<bool(const std::string&)> set; // false if the value is out of range
+        };
+
+        std::string program;
+        std::vector<Option> options;
+
+    public:
+        unsigned seed{ 42 };
+        std::string format{ "csv" };
+        std::string out;
+
+        explicit CommandLine(std::string _program) : program{ std::move(_program) } {}
+
+        template<typename T>
+        void count(const std::string& flag, T& target, bool allow_zero = false) {
+            options.push_back(Option{ flag, "N", [&target, allow_zero](const std::string& value) {
+                target = static_cast<T>(parse_count(value));
+                return allow_zero || target > 0;
+            } });
+        }
+
+        template<typename T>
+        void counts(const std::string& flag, std::vector<T>& target, bool allow_zero = false) {
+            options.push_back(Option{ flag, "N,N,...", [&target, allow_zero](const std::string& list) {
+                target.clear();
+                std::stringstream stream{ list };
+                std::string item;
+                while (std::getline(stream, item, ',')) {
+                    target.push_back(static_cast<T>(parse_count(item)));
+                    if (!allow_zero && target.back() == 0) return false;
+                }
+                return !target.empty();
+            } });
+        }
+
+        void text(const std::string& flag, const std::string& placeholder, std::string& target) {
+            options.push_back(Option{ flag, placeholder, [&target](const std::string& value) {
+                target = value;
+                return true;
+            } });
+        }
+
+        void usage() const {
+            std::cerr << "usage: " << program;
+            for (const Option& option: options) {
+                std::cerr << " [" << option.flag << ' ' << option.placeholder << ']';
+            }
+            std::cerr << " [--seed N] [--format csv|json] [--out FILE]\n";
+        }
+
+        // false after printing the usage if an option is unknown, lacks its value or has an invalid one
+        bool parse(int argc, char** argv) {
+            try {
+                for (int i{ 1 }; i < argc; i += 2) {
+                    std::string flag{ argv[i] };
+                    if (i + 1 >= argc) throw std::invalid_argument(flag);
+                    std::string value{ argv[i + 1] };
+                    bool valid;
+                    if (flag == "--seed") {
+                        seed = static_cast<unsigned>(std::stoul(value));
+                        valid = true;
+                    } else if (flag == "--format") {
+                        format = value;
+                        valid = format == "csv" || format == "json";
+                    } else if (flag == "--out") {
+                        out = value;
+                        valid = true;
+                    } else {
+                        auto option{ std::find_if(options.begin(), options.end(), [&flag](const Option& o) { return o.flag == flag; }) };
+                        valid = option != options.end() && option->set(value);
+                    }
+                    if (!valid) throw std::invalid_argument(flag);
+                }
+            } catch (const std::exception&) {
+                usage();
+                return false;
+            }
+            return true;
+        }
+    };
+
+    // one cell of a result row, text cells are quoted in JSON
+    struct Cell {
+        std::string value;
+        bool text;
+
+        Cell(const char* _value) : value{ _value }, text{ true } {}
+
+        Cell(std::string _value) : value{ std::move(_value) }, text{ true } {}
+
+        template<typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+        Cell(T number) : text{ false } {
+            std::ostringstream stream;
+            stream << number;
+            value = stream.str();
+        }
+    };
+
+    // rows under fixed columns. every row is echoed to stderr as it comes in, an "errors" column other than 0
+    // in any row makes the benchmark fail
+    class Results {
+        std::vector<std::string> columns;
+        std::vector<std::vector<Cell>> rows;
+
+    public:
+        explicit Results(std::vector<std::string> _columns) : columns{ std::move(_columns) } {}
+
+        void add(std::vector<Cell> row) {
+            for (size_t i{ 0 }; i < row.size(); ++i) {
+                std::cerr << (i > 0 ? " " : "") << columns[i] << '=' << row[i].value;
+            }
+            std::cerr << '\n';
+            rows.push_back(std::move(row));
+        }
+
+        [[nodiscard]] bool failed() const {
+            auto errors{ std::find(columns.begin(), columns.end(), "errors") };
+            if (errors == columns.end()) return false;
+            size_t column{ static_cast<size_t>(errors - columns.begin()) };
+            return std::any_of(rows.begin(), rows.end(), [column](const std::vector<Cell>& row) { return row[column].value != "0"; });
+        }
+
+        void write_csv(std::ostream& o) const {
+            for (size_t i{ 0 }; i < columns.size(); ++i) {
+                o << (i > 0 ? "," : "") << columns[i];
+            }
+            o << '\n';
+            for (const std::vector<Cell>& row: rows) {
+                for (size_t i{ 0 }; i < row.size(); ++i) {
+                    o << (i > 0 ? "," : "") << row[i].value;
+                }
+                o << '\n';
+            }
+        }
+
+        void write_json(std::ostream& o) const {
+            o << "[\n";
+            for (size_t r{ 0 }; r < rows.size(); ++r) {
+                o << "  {";
+                for (size_t i{ 0 }; i < rows[r].size(); ++i) {
+                    const Cell& cell{ rows[r][i] };
+                    o << (i > 0 ? ", " : "") << '"' << columns[i] << "\": ";
+                    if (cell.text) {
+                        o << '"' << cell.value << '"';
+                    } else {
+                        o << cell.value;
+                    }
+                }
+                o << '}' << (r + 1 < rows.size() ? "," : "") << '\n';
+            }
+            o << "]\n";
+        }
+
+        // writes the results in the format of the command line to its --out file or stdout and returns the exit
+        // code: 1 if the file can not be opened or a row has errors
+        int finish(const CommandLine& command_line) const {
+            std::ofstream file;
+            if (!command_line.out.empty()) {
+                file.open(command_line.out);
+                if (!file) {
+                    std::cerr << "cannot open " << command_line.out << '\n';
+                    return 1;
+                }
+            }
+            std::ostream& o{ command_line.out.empty() ? std::cout : file };
+            if (command_line.format == "json") {
+                write_json(o);
+            } else {
+                write_csv(o);
+            }
+            return failed() ? 1 : 0;
+        }
+    };
+}
+
+#endif
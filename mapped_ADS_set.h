@@ -0,0 +1,263 @@
+#ifndef MAPPED_ADS_SET_H
+#define MAPPED_ADS_SET_H
+
+#include "ADS_set.h"
+
+#include<cerrno>
+#include<system_error>
+
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+// read-only set over a file written by ADS_set::save. the file is mapped as a whole and every operation reads the
+// node pages in place, nothing is deserialized: opening is O(1) in the number of keys, pages are faulted in on
+// first use and shared through the page cache by all processes mapping the same file
+template<typename Key>
+class mapped_ADS_set {
+public:
+    class Iterator;
+
+    using value_type = Key;
+    using key_type = Key;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_iterator = Iterator;
+    using iterator = const_iterator;
+    using key_compare = std::less<key_type>;
+
+private:
+    using Layout = ads_detail::PageLayout<key_type>;
+    using PageHeader = ads_detail::PageHeader;
+    static constexpr std::less<key_type> cmp = key_compare{};
+    static_assert(std::is_trivially_copyable_v<key_type>, "only trivially copyable keys can be mapped");
+
+    const unsigned char* base{ nullptr };
+    size_t length{ 0 };
+    uint64_t root{ 0 };
+    size_type sz{ 0 };
+
+    static const unsigned char* page(const unsigned char* base, uint64_t number) {
+        return base + number * ads_detail::page_size;
+    }
+
+    // page of the leaf responsible for key
+    uint64_t find_leaf(const key_type& key) const {
+        uint64_t node{ root };
+        for (const unsigned char* current{ page(base, node) }; Layout::header(current)->type == ads_detail::PageType::INTERNAL; current = page(base, node)) {
+            node = Layout::child_pages(current)[Layout::template rank<true>(current, key)]; // keys equal to a separator live right of it
+        }
+        return node;
+    }
+
+    // iterator to position pos of leaf, pos == count continues at the first key of the next leaf
+    Iterator leaf_iterator(uint64_t leaf, size_type pos) const {
+        const PageHeader* current{ Layout::header(page(base, leaf)) };
+        if (pos < current->count) return Iterator(base, leaf, pos);
+        return current->next ? Iterator(base, current->next, 0) : Iterator();
+    }
+
+    void unmap() {
+        if (base) munmap(const_cast<unsigned char*>(base), length);
+        base = nullptr;
+        length = 0;
+    }
+
+public:
+    // maps the file at path, throws std::system_error if it can not be opened or mapped and std::runtime_error
+    // if it was not written by ADS_set<Key>::save
+    explicit mapped_ADS_set(const std::string& path) {
+        int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error{ errno };
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length < ads_detail::page_size) {
+            ::close(fd);
+            throw std::runtime_error(path + " is not an ADS_set file");
+        }
+        void* mapping{ mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) };
+        int error{ errno };
+        ::close(fd); // the mapping stays valid
+        if (mapping == MAP_FAILED) throw std::system_error(error, std::generic_category(), "cannot map " + path);
+        base = static_cast<const unsigned char*>(mapping);
+
+        ads_detail::FileHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, ads_detail::file_magic, sizeof(header.magic)) != 0 || header.version != ads_detail::file_version
+            || header.page_size != ads_detail::page_size || header.byte_order != ads_detail::file_byte_order
+            || header.key_size != sizeof(key_type) || header.key_align != alignof(key_type)
+            || header.pages > length / ads_detail::page_size || header.root == 0 || header.root >= header.pages) {
+            unmap();
+            throw std::runtime_error(path + " is not an ADS_set file for this key type");
+        }
+        root = header.root;
+        sz = static_cast<size_type>(header.size);
+        TRACE_DEB("mapped_ADS_set opened " << path << " with " << sz << " keys")
+    }
+
+    mapped_ADS_set(const mapped_ADS_set&) = delete;
+
+    mapped_ADS_set& operator=(const mapped_ADS_set&) = delete;
+
+    mapped_ADS_set(mapped_ADS_set&& other) noexcept : base{ other.base }, length{ other.length }, root{ other.root }, sz{ other.sz } {
+        other.base = nullptr;
+        other.length = 0;
+        other.sz = 0;
+    }
+
+    mapped_ADS_set& operator=(mapped_ADS_set&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            std::swap(base, other.base);
+            std::swap(length, other.length);
+            std::swap(root, other.root);
+            std::swap(sz, other.sz);
+        }
+        return *this;
+    }
+
+    ~mapped_ADS_set() {
+        unmap();
+    }
+
+    [[nodiscard]] size_type size() const {
+        return sz;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return sz == 0;
+    }
+
+    size_type count(const key_type& key) const {
+        if (!base) return 0;
+        const unsigned char* leaf{ page(base, find_leaf(key)) };
+        size_type pos{ Layout::template rank<false>(leaf, key) };
+        return pos < Layout::header(leaf)->count && !cmp(key, Layout::keys(leaf)[pos]) ? 1 : 0;
+    }
+
+    const_iterator find(const key_type& key) const {
+        if (!base) return end();
+        uint64_t leaf{ find_leaf(key) };
+        const unsigned char* current{ page(base, leaf) };
+        size_type pos{ Layout::template rank<false>(current, key) };
+        if (pos < Layout::header(current)->count && !cmp(key, Layout::keys(current)[pos])) return Iterator(base, leaf, pos);
+        return end();
+    }
+
+    const_iterator lower_bound(const key_type& key) const {
+        if (!base) return end();
+        uint64_t leaf{ find_leaf(key) };
+        return leaf_iterator(leaf, Layout::template rank<false>(page(base, leaf), key));
+    }
+
+    const_iterator upper_bound(const key_type& key) const {
+        if (!base) return end();
+        uint64_t leaf{ find_leaf(key) };
+        return leaf_iterator(leaf, Layout::template rank<true>(page(base, leaf), key));
+    }
+
+    // calls visitor for every key in [lo, hi) in ascending order and returns the number of visited keys, like
+    // ADS_set::for_each_in_range. a visitor returning bool stops the scan by returning false
+    template<typename Visitor>
+    size_type for_each_in_range(const key_type& lo, const key_type& hi, Visitor&& visitor) const {
+        if (!base || !cmp(lo, hi)) return 0;
+        const unsigned char* leaf{ page(base, find_leaf(lo)) };
+        size_type pos{ Layout::template rank<false>(leaf, lo) };
+        size_type visited{ 0 };
+        while (true) {
+            const key_type* keys{ Layout::keys(leaf) };
+            size_type count{ Layout::header(leaf)->count };
+            bool last{ count > 0 && !cmp(keys[count - 1], hi) }; // range ends in this leaf
+            size_type stop{ last ? Layout::template rank<false>(leaf, hi) : count };
+            for (; pos < stop; ++pos, ++visited) {
+                if constexpr(std::is_same_v<std::invoke_result_t<Visitor&, const key_type&>, bool>) {
+                    if (!visitor(keys[pos])) return visited + 1;
+                } else {
+                    visitor(keys[pos]);
+                }
+            }
+            if (last || !Layout::header(leaf)->next) break;
+            leaf = page(base, Layout::header(leaf)->next);
+            pos = 0;
+        }
+        return visited;
+    }
+
+    const_iterator begin() const {
+        if (!base || sz == 0) return end();
+        uint64_t node{ root };
+        for (const unsigned char* current{ page(base, node) }; Layout::header(current)->type == ads_detail::PageType::INTERNAL; current = page(base, node)) {
+            node = Layout::child_pages(current)[0];
+        }
+        return Iterator(base, node, 0);
+    }
+
+    const_iterator end() const {
+        return Iterator();
+    }
+};
+
+template<typename Key>
+class mapped_ADS_set<Key>::Iterator {
+public:
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using iterator_category = std::forward_iterator_tag;
+
+private:
+    const unsigned char* base;
+    uint64_t leaf; // page number, 0 for the end iterator
+    size_type pos;
+
+public:
+    Iterator() : base{ nullptr }, leaf{ 0 }, pos{ 0 } {}
+
+    explicit Iterator(const unsigned char* _base, uint64_t _leaf, size_type _pos) : base{ _base }, leaf{ _leaf }, pos{ _pos } {}
+
+    reference operator*() const {
+        return Layout::keys(page(base, leaf))[pos];
+    }
+
+    pointer operator->() const {
+        return Layout::keys(page(base, leaf)) + pos;
+    }
+
+    Iterator& operator++() {
+        if (leaf) {
+            const PageHeader* current{ Layout::header(page(base, leaf)) };
+            if (pos + 1 == current->count) {
+                leaf = current->next;
+                pos = 0;
+            } else {
+                ++pos;
+            }
+        }
+        return *this;
+    }
+
+    Iterator operator++(int) {
+        Iterator old{ *this };
+        this->operator++();
+        return old;
+    }
+
+    bool operator==(const Iterator& rhs) const {
+        return leaf == rhs.leaf && pos == rhs.pos;
+    }
+
+    bool operator!=(const Iterator& rhs) const {
+        return leaf != rhs.leaf || pos != rhs.pos;
+    }
+};
+
+#endif